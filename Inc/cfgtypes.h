@@ -59,7 +59,7 @@ struct s_config {
 typedef struct s_tip TIP;
 struct s_tip {
 	uint16_t	t200, t260, t330, t400;				// The internal temperature in reference points
-	uint8_t		mask;								// The bit mask: TIP_ACTIVE + TIP_CALIBRATED
+	uint8_t		mask;								// The bit mask: TIP_ACTIVE + TIP_CALIBRATED + TIP_CURVE
 	char		name[tip_name_sz];					// T12 tip name suffix, JL02 for T12-JL02
 	int8_t		ambient;							// The ambient temperature in Celsius when the tip being calibrated
 	uint8_t		crc;								// CRC checksum
@@ -85,6 +85,32 @@ struct s_tip_table {
 	uint8_t		tip_mask;							// The bit mask: 0 - active, 1 - calibrated
 };
 
-typedef enum tip_status { TIP_ACTIVE = 1, TIP_CALIBRATED = 2 } TIP_STATUS;
+// TIP_CURVE: the reference points are the samples of the fitted calibration curve, interpolate them by the cubic
+typedef enum tip_status { TIP_ACTIVE = 1, TIP_CALIBRATED = 2, TIP_CURVE = 4 } TIP_STATUS;
+
+/*
+ * Usage statistics record in the statistics area of the EEPROM, one record per chunk.
+ * Every record holds the totals of one tip and the Hot Air Gun totals at the time the record was saved,
+ * so the record with the biggest ID has the actual Hot Air Gun data.
+ * The heat-up signature (rise, early) is the temperature rise of the cold tip at the full power in internal units,
+ * see IRON::heatSignature(). It is used to identify the inserted tip
+ */
+typedef struct s_stats STATS;
+struct s_stats {
+	uint32_t	ID;									// The statistics record ID
+	uint16_t	crc;								// The checksum
+	uint8_t		tip;								// The tip index in the global tip list
+	uint8_t		base_n;								// The number of samples in the holding power baseline
+	uint32_t	iron_sec;							// The time the tip heater was powered, seconds
+	uint32_t	iron_energy;						// The energy delivered to the tip, J
+	uint32_t	gun_sec;							// The time the Hot Air Gun was working, seconds
+	uint16_t	iron_cycles;						// The number of the tip heat cycles
+	uint16_t	gun_cycles;							// The number of the Hot Air Gun heat cycles
+	uint16_t	base_hold;							// The holding power of the fresh tip per 100 Celsius above ambient
+	uint16_t	hold;								// The actual holding power per 100 Celsius above ambient
+	uint16_t	rise;								// The temperature rise during the heat-up signature window
+	uint8_t		early;								// The temperature rise before the signature window (heater to sensor delay)
+	uint8_t		sig_n;								// The number of heat-ups averaged in the signature
+};
 
 #endif
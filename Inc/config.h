@@ -39,6 +39,7 @@ class CFG_CORE: public TIPS {
 		uint16_t	getLowTemp(void)					{ return a_cfg.low_temp; 				}
 		uint8_t		getLowTO(void)						{ return a_cfg.low_to; 					}	// 5-seconds intervals
 		uint8_t		getScrTo(void)						{ return a_cfg.scr_save_timeout;		}
+		uint8_t		ironTipIndex(void)					{ return a_cfg.tip;						}	// The IRON tip even if the Hot Air Gun is active
 		void		setup(uint8_t off_timeout, bool buzzer, bool celsius, bool keep_iron, bool reed, bool big_temp_step, bool auto_start,
 						uint16_t low_temp, uint8_t low_to, uint8_t scr_saver);
 		void 		savePresetTempHuman(uint16_t temp_set);
@@ -81,12 +82,13 @@ class TIP_CFG {
 		uint16_t	referenceTemp(uint8_t index, CFG_TEMP_DEVICE force_device = DEV_DEFAULT);
 		uint16_t	tempCelsius(uint16_t temp, int16_t ambient, CFG_TEMP_DEVICE force_device = DEV_DEFAULT);
 		void		getTipCalibtarion(uint16_t temp[4]);
-		void		applyTipCalibtarion(uint16_t temp[4], int8_t ambient);
+		void		applyTipCalibtarion(uint16_t temp[4], int8_t ambient, bool curve = false);
 		void		resetTipCalibration(void);
 	protected:
 		void 		defaultCalibration(bool gun = false);
 		bool		isValidTipConfig(TIP *tip);
 	private:
+		int32_t		curveTemp(uint8_t i, int16_t t, CFG_TEMP_DEVICE force_device);
 		TIP_RECORD	tip[2];								// Active IRON tip (0) and Hot Air Gun virtual tip (1)
 		uint16_t	t_minC				= 0;
 		uint16_t	t_maxC				= 0;
@@ -104,11 +106,14 @@ class CFG : public EEPROM, public CFG_CORE, public TIP_CFG, public BUZZER {
 		uint16_t	humanToTemp(uint16_t temp, int16_t ambient);
 		uint16_t	lowTempInternal(int16_t ambient);
 		const char* tipName(void);
+		const char*	ironTipName(void);
+		const char*	droppedStatsTipName(void);			// The tip whose usage statistics were overwritten or 0
 		void     	changeTip(uint8_t index);
 		uint8_t		currentTipIndex(void);
 		void		saveTipCalibtarion(uint8_t index, uint16_t temp[4], uint8_t mask, int8_t ambient);
 		bool		toggleTipActivation(uint8_t index);
 		int			tipList(uint8_t second, TIP_ITEM list[], uint8_t list_len, bool active_only);
+		uint8_t		tipMask(uint8_t index);				// The tip status bit mask (TIP_STATUS) or zero if the tip does not exist
 		void		saveConfig(void);
 		void		savePID(PIDparam &pp, bool iron = true);
 		void 		initConfigArea(void);
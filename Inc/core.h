@@ -14,8 +14,14 @@
 typedef	uint8_t	bool;
 #endif
 
+// The controller startup phases. See bootPhaseTime()
+typedef enum { BOOT_START = 0, BOOT_DISPLAY, BOOT_CONFIG, BOOT_TIMERS, BOOT_AC_SYNC, BOOT_READY, BOOT_PHASES } BOOT_PHASE;
+
 // Forward function declaration
-bool isACsine(void);
+bool 		isACsine(void);
+uint16_t	bootPhaseTime(BOOT_PHASE phase);				// Time (ms since reset) when the startup phase has been finished
+uint16_t	loopsPerSecond(void);							// The main loop iterations (processed events) during last second
+uint8_t		idlePercent(void);								// The time the CPU was sleeping during last second, percent
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +29,7 @@ extern "C" {
 
 void setup(void);
 void loop(void);
+void coreTick(void);										// Called by SysTick interrupt handler every ms
 
 #ifdef __cplusplus
 }
@@ -9,17 +9,55 @@
 #include "main.h"
 #include "oled.h"
 #include "config.h"
+#include "swtimer.h"
+#include "recorder.h"
 
 typedef enum { SCR_MODE_OFF = 0, SCR_MODE_IRON_ON,  SCR_MODE_IRON_STBY, SCR_MODE_GUN_ON } SCR_MODE;
+typedef enum { VIEW_NONE = 0, VIEW_MAIN, VIEW_TUNE } DSPL_VIEW;
 
 const uint16_t	d_width		= 128;        					// display width
 const uint16_t  d_height	= 64;        					// display height
+const uint8_t	digit_cache_w	= 20;						// Maximum glyph width of the large digit in the cache
+
+// The glyph of the large digit decoded into the display memory order (vertical bytes)
+typedef struct s_digit_glyph {
+	int8_t		x;											// The glyph box offset from the pen position
+	uint8_t		width;										// The glyph box width
+	uint8_t		advance;									// The pen shift after the glyph
+	uint32_t	box;										// The rows of glyph box (solid font mode background)
+	uint32_t	ink[digit_cache_w];							// The glyph pixel columns
+} DIGIT_GLYPH;
+
+// The data shown on the main screen. The screen is not redrawn if the data have not been changed
+typedef struct s_main_view {
+	uint16_t	t_set;
+	uint16_t	t_cur;
+	uint16_t	t_alter;
+	int16_t		t_amb;
+	uint8_t		temp_bar;
+	uint8_t		p_height;
+	uint8_t		fan_index;
+	bool		tilt;
+	bool		celsius;
+	bool		calibrated;
+	char		msg[8];
+	char		tip[10];
+} MAIN_VIEW;
+
+// The data shown on the tune screen
+typedef struct s_tune_view {
+	uint16_t	tune_temp;
+	uint8_t		pwr_pcnt;
+	uint8_t		t_len;
+	char		msg[8];
+} TUNE_VIEW;
 
 class DSPL : public U8G2 {
 	public:
 		DSPL(void)	: U8G2()								{ }
 		void		init(void);
-		void		mainInit(void)							{ msg_buff[0] = tip_name[0] = 0; }
+		void		sendBuffer(void);						// Send the modified tiles of the frame by DMA
+		void		mainInit(void)							{ msg_buff[0] = tip_name[0] = 0; bg_valid = false; t_shown = 0; }
 		void		status(const char *msg);
 		void 		msgClean(void);
 		void 		msgOFF(void);
@@ -53,14 +91,25 @@ class DSPL : public U8G2 {
 		void 		menuItemShow(const char* title, const char* item, const char* value, bool modify);
 		void 		errorShow(void);
 		void		errorMessage(const char *msg);
-		void 		debugShow(bool gun_mode, uint16_t power, bool iron, bool gun, uint16_t data[4]);
+		void 		debugShow(bool gun_mode, uint16_t power, bool iron, bool gun, uint16_t data[4], uint8_t idle_pcnt);
 		void 		showVersion(void);
+		void		bootShow(uint16_t phase_ms[6]);
+		void		flightShow(FLREC *rec, uint8_t cursor, bool gun, const char *info);
+		void		usageShow(const char *tip_name, int8_t health, uint32_t iron_sec, uint16_t cycles, uint32_t energy, uint32_t gun_sec,
+							const char *dropped_tip);
+		uint16_t	renderTime(void)						{ return render_us; }
 	private:
+		void		mainBackground(bool is_celsius, bool tip_calibrated);
+		void		buildDigitCache(void);
+		void		drawDigits(int16_t x, int16_t y, const char *str);
+		void		drawCachedDigit(int16_t x, int16_t y, const DIGIT_GLYPH *g);
+		bool		viewChanged(DSPL_VIEW id, const void *view, uint8_t size);
+		void		viewSave(DSPL_VIEW id, const void *view, uint8_t size);
 		char      	msg_buff[8]			= {0};             	// the buffer for the message in top right corner
 		char      	tip_name[10]		= {0};				// the buffer for tip name
 		char		err_msg[40]			= {0};			   	// the buffer of error message
 		// PID tune data
-		uint32_t	default_mode = 0;						// The time in ms to return to the default mode
+		SWTIMER		default_mode;							// Show the modified value or message till the timer expires
 		char		modified_value[25]	= {0};				// The buffer to show current value of being modified coefficient
 		char		lower_axis[3]		= {0}; 				// Lower axis label (2 symbols and '\0' at the end)
 		int16_t		h_temp[80]			= {0};				// The temperature history data
@@ -70,6 +119,25 @@ class DSPL : public U8G2 {
 		// Screen saver data
 		uint16_t	saver_center[2] 	= {d_width/2, d_height/2};	// Current center of the output data
 		int8_t		saver_speed[2]		= {1, 1};			// Current speed of center pointer
+		uint8_t		tx_frame[d_width*d_height/8];			// The frame being transferred to the display by DMA, the display content
+		bool		full_frame			= true;				// Send whole frame next time, the display content is unknown
+		// Main screen static layer
+		uint8_t		bg_frame[d_width*d_height/8];			// The static part of the main screen
+		char		bg_tip[10]			= {0};				// The tip name drawn in the static layer
+		bool		bg_celsius			= true;				// The temperature units drawn in the static layer
+		bool		bg_calibrated		= true;				// The tip calibration mark drawn in the static layer
+		bool		bg_valid			= false;			// Whether the static layer is actual
+		uint16_t	render_us			= 0;				// The main screen render time, mks (debug only)
+		// Large digits cache
+		DIGIT_GLYPH	digit_cache[10];						// The pre-decoded glyphs of u8g2_font_kam28n digits
+		bool		digit_cache_ok		= false;			// Whether the digit cache is built
+		// The data of the screen being displayed
+		DSPL_VIEW	view_id				= VIEW_NONE;		// The screen shown on the display or VIEW_NONE if unknown
+		uint8_t		view_data[32];							// The data of the screen shown, MAIN_VIEW or TUNE_VIEW
+		static_assert(sizeof(MAIN_VIEW) <= sizeof(view_data), "MAIN_VIEW does not fit view_data");
+		static_assert(sizeof(TUNE_VIEW) <= sizeof(view_data), "TUNE_VIEW does not fit view_data");
+		uint16_t	t_shown				= 0;				// The temperature shown on the main screen, see mainShow()
+		const		uint8_t		t_hysteresis	= 1;		// Do not redraw the main screen if the temperature changed by this value
 };
 
 void	DPIDK_init(void);
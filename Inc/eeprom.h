@@ -6,12 +6,18 @@
  *
  * The data in the EEPROM is addressed by chunks.
  * There are 128 chunks of 32 bytes in the EEPROM IC at24c32a.
- * First 64 chunks [0-63] are used to store configuration data.
+ * First 48 chunks [0-47] are used to store configuration data.
  * One record per chunk as soon the configuration record can fit into one chunk.
  * To save EEPROM rewrite cycles, new record is written to the next free chunk, increasing record ID.
  * When the controller starts, it reads all the chunks in the configuration area and find the last record
  * that has the biggest record ID.
  *
+ * The chunks [48-63] are the usage statistics area (see STATS in cfgtypes.h), one record per chunk.
+ * Every record has the statistics of one tip and the ID. The new record is written over the oldest record that is not
+ * the actual record of some tip, so the writes are spread over all the area while the data of every tip is kept.
+ * The area keeps the statistics of 16 tips at most. When the statistics of the 17-th tip are saved, the actual record
+ * of the tip saved least recently is overwritten and the history of that tip is lost, see droppedStats().
+ *
  * Last 64 chunks [64-127] are used to store the tip configuration data.
  * As soon as tip configuration requires only 16 bytes, two records can fit to the chunk.
  * Only active and calibrated tips are stored in this area.
@@ -24,16 +30,29 @@
  * These functions read and write the EEPROM chunk from/to static data buffer.
  * To increase performance, last read and written chunk index is stored to chunk_in_data variable.
  * readChunk( function returns immediately, if data in the buffer is already actual.
+ *
+ * If EEPROM_MIRROR is defined, the configuration and the statistics areas (the first eeprom_mirror_chunks chunks, 2 KB)
+ * are read into the RAM mirror once when the controller starts. The tip area is not mirrored, the last read or written
+ * eeprom_tip_cache chunks of the tip area are kept in the RAM read cache instead, so the tip change reads the cache.
+ * The tip chunks are written through to the EEPROM IC immediately.
+ * readChunk() just copies the chunk from the mirror, writeChunk() updates the mirror and marks the chunk as dirty.
+ * The dirty chunks are written back to the EEPROM IC by writeBack() when the data was not changed for wb_delay ms,
+ * so several changes of the same chunk are saved by one EEPROM write. forceReloadChunk() flushes all dirty chunks
+ * and forces next readChunk() to read the data from the EEPROM IC, to check the data was saved correctly.
  */
 
 #ifndef EEPROM_H_
 #define EEPROM_H_
 #include "main.h"
 #include "cfgtypes.h"
+#include "swtimer.h"
 
 typedef enum tip_io_status {EPR_OK = 0, EPR_IO, EPR_CHECKSUM, EPR_INDEX} TIP_IO_STATUS;
 
 #define eeprom_chunk_size	(32)						// Number of bytes in one EEPROM chunk
+#define eeprom_mirror_chunks (64)						// The chunks kept in the RAM mirror: configuration and statistics areas
+#define eeprom_tip_cache	(8)							// The chunks of the tip area kept in the RAM read cache (16 tips)
+#define EEPROM_MIRROR									// Keep the configuration and statistics areas and the tip cache in the RAM
 
 class EEPROM {
 	public:
@@ -45,22 +64,57 @@ class EEPROM {
 		TIP_IO_STATUS 	loadTipData(TIP* tip, uint8_t tip_chunk_index);
 		TIP_IO_STATUS	saveTipData(TIP* tip, uint8_t tip_chunk_index);
 		void 			clearConfigArea(void);
-		void			forceReloadChunk(void)			{ chunk_in_data	= 65535; }
+		void			forceReloadChunk(void);
+		void			writeBack(bool force = false);		// Write dirty chunks of RAM mirror to the EEPROM IC
+		bool			loadStats(STATS* stats, uint8_t tip);	// Load the statistics of the tip
+		bool			loadLastStats(STATS* stats);		// Load the latest statistics record
+		bool			saveStats(STATS* stats);			// Modifies the record: set the ID and calculate CRC
+		bool			loadStatsRecord(STATS* stats, uint8_t n);	// Load n-th record of the statistics area if it is actual
+		uint8_t			statsTotal(void)					{ return stat_chunks; }
+		int16_t			droppedStats(void)					{ return stat_dropped; }	// The tip whose statistics were overwritten or -1
 	private:
 		bool 			readChunk(uint16_t chunk_index);
 		bool 			writeChunk(uint16_t chunk_index);
+		bool			busReady(void);
+		bool			readEEPROM(uint16_t chunk_index, uint8_t *buff);
+		bool			writeEEPROM(uint16_t chunk_index, uint8_t *buff);
 		uint8_t 		CFG_checkSum(RECORD* cfg, bool write);
 		uint8_t 		TIP_checkSum(TIP* tip, bool write);
+		bool			STAT_checkSum(STATS* stats, bool write);
+		void			scanStats(void);
+		void			upgradeConfigArea(void);			// Move the configuration records out of the statistics area
+		int8_t			statChunk(uint8_t tip);				// The chunk with the actual statistics of the tip or -1
 		uint16_t 		requiredTipSpace(void);
+#ifdef EEPROM_MIRROR
+		int8_t			tipCacheSlot(uint16_t chunk_index);	// The tip cache slot holding the chunk or -1
+		void			tipCacheStore(uint16_t chunk_index);	// Put the data buffer into the tip cache
+#endif
 		I2C_HandleTypeDef* 	hi2c	= 0;
 		bool		can_write				= false;	// The flag indicates that data can be saved to the EEPROM
 		uint16_t	r_chunk					= 0;		// Chunk number of the correct record in EEPROM to be read
 		uint16_t	w_chunk					= 0;		// Chunk number in the EEPROM to start write new record
 		uint8_t  	data[eeprom_chunk_size];			// Data buffer for one EEPROM chunk
 		uint16_t	chunk_in_data			= 65535;	// Current chunk number in the data buffer [0-(eeprom_chunks-1)]. For caching
+#ifdef EEPROM_MIRROR
+		bool		mirror_loaded			= false;	// Whether the EEPROM data was loaded into the mirror
+		bool		reload_chunk			= false;	// Read next chunk from the EEPROM IC, not from the mirror
+		uint32_t	dirty[eeprom_mirror_chunks / 32] = { 0 };	// Bitmap of the chunks modified in the mirror
+		SWTIMER		wb_timer;							// Write dirty chunks to the EEPROM IC when expired
+		uint8_t		mirror[eeprom_mirror_chunks * eeprom_chunk_size];	// RAM copy of the configuration and statistics areas
+		uint8_t		tip_cache[eeprom_tip_cache * eeprom_chunk_size];	// RAM copy of the recently used tip area chunks
+		uint16_t	tip_cache_chunk[eeprom_tip_cache] = { 0 };	// The chunk in the cache slot, 0 if the slot is empty
+		uint8_t		tip_cache_next			= 0;		// The cache slot to be replaced next
+		const uint16_t		wb_delay		= 1000;		// Delay to accumulate the changes before writing the data (ms)
+#endif
 		const uint16_t		eeprom_chunks 	= 128;		// The number of chunks in my EEPROM IC
 		const uint16_t  	eeprom_address 	= 0x50;		// AT24C32 EEPROM IC address on the I2C bus
-		const uint16_t		cfg_chunks		= 64;		// The space of EEPROM (in chunks) dedicated to the configuration data
+		uint32_t	stat_id[16]				= { 0 };	// The IDs of the statistics records, 0 if the chunk is empty
+		uint8_t		stat_tip[16]			= { 0 };	// The tip indexes of the statistics records
+		uint32_t	stat_max_id				= 0;		// The biggest ID of the statistics records
+		int16_t		stat_dropped			= -1;		// The tip index whose actual statistics were overwritten since power on
+		const uint16_t		cfg_chunks		= 48;		// The space of EEPROM (in chunks) dedicated to the configuration data
+		const uint16_t		stat_first		= 48;		// The first chunk of the statistics area
+		const uint16_t		stat_chunks		= 16;		// The number of chunks of the statistics area
 		const uint16_t		tip_chunks		= 64;		// The maximum number of chunks used to store the configured tips
 };
 
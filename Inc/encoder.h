@@ -8,49 +8,71 @@
 #ifndef ENCODER_H_
 #define ENCODER_H_
 #include "main.h"
-#include "stat.h"
+
+typedef enum { BTN_PRESS = 1, BTN_LONG, BTN_RELEASE } BTN_EVENT_TYPE;
+
+typedef struct s_btn_event {
+	uint8_t		type;										// BTN_EVENT_TYPE
+	uint32_t	time;										// The event time, ms
+} BTN_EVENT;
+
+#define BTN_QUEUE_LEN	(8)									// The button event queue size, should be a power of 2
 
 class RENC {
 	public:
 		RENC(GPIO_TypeDef* aPORT, uint16_t aPIN, GPIO_TypeDef* bPORT, uint16_t bPIN);
 		void 		addButton(GPIO_TypeDef* ButtonPORT, uint16_t ButtonPIN);
 		uint8_t		buttonStatus(void);
+		bool		buttonTick(uint32_t now_t);				// Sample the button, called from SysTick. True if new event queued
+		bool		buttonEvent(BTN_EVENT &ev);				// Get the next button event from the queue
 		bool		write(int16_t initPos);
 		void    	reset(int16_t initPos, int16_t low, int16_t upp, uint8_t inc, uint8_t fast_inc, bool looped);
-		void 		encoderIntr(void);
+		void 		encoderIntr(void);						// Called when any channel of the encoder changed
+		void		quadrature(uint8_t ab, uint32_t now_t);	// Decode new channels state, ab = (A << 1) | B
 		void 		setTimeout(uint16_t timeout_ms)			{ over_press = timeout_ms; }
 		void    	setIncrement(uint8_t inc)           	{ increment = fast_increment = inc; }
 		uint8_t		getIncrement(void)                 		{ return increment; }
 		int16_t 	read(void)                          	{ return pos; }
 	private:
-		EMP_AVERAGE			avg;							// Do average the button readings to maintain the button status
+		void				step(int8_t dir, uint32_t now_t);
+		uint8_t				acceleration(uint32_t interval);
+		bool				pushButton(uint8_t type, uint32_t time);
 		int16_t				min_pos	= 0;					// Minimum value of rotary encoder
 		int16_t				max_pos	= 0;					// Maximum value of roraty encoder
 		uint16_t			over_press = 0;					// Maximum time in ms the button can be pressed
 		bool              	is_looped = false;          	// Whether the encoder is looped
 		uint8_t            	increment = 0;              	// The value to add or substract for each encoder tick
 		uint8_t             fast_increment = 0;         	// The value to change encoder when it runs quickly
-		volatile uint32_t 	rpt		= 0;                	// Time in ms when the encoder was rotated
 		volatile uint32_t 	changed	= 0;                	// Time in ms when the value was changed
 		volatile int16_t  	pos		= 0;                	// Encoder current position
-		volatile bool       s_up	= false;				// The status of the secondary channel
-		bool				i_b_rel	= false;				// Ignore button release event
-		bool				b_on	= false;				// The button current position: true - pressed
-		uint32_t 			bpt		= 0;                	// Time in ms when the button was pressed (press time)
-		uint32_t			b_check	= 0;					// Time in ms when the button should be checked
+		volatile uint8_t	ab_state	= 3;				// Previous state of the channels, (A << 1) | B
+		volatile int8_t		q_steps		= 0;				// Quarter steps accumulated since the detent position
+		volatile int8_t		d_dir		= 0;				// The direction of the last detent
+		volatile uint16_t	d_interval	= 0;				// Averaged interval between detents, ms
+		bool				accel_on	= false;			// Whether the velocity acceleration is enabled for current range
+		volatile uint8_t	b_integr	= 0;				// The debounce integrator of the button readings
+		volatile bool		b_on		= false;			// The button debounced position: true - pressed
+		volatile bool		b_long		= false;			// The long press event has been queued for current press
+		volatile uint32_t	bpt			= 0;				// Time in ms when the button was pressed (press time)
+		BTN_EVENT			b_queue[BTN_QUEUE_LEN];			// The button events queue, filled by SysTick
+		volatile uint8_t	b_head		= 0;				// The queue write index
+		volatile uint8_t	b_tail		= 0;				// The queue read index
+		uint32_t			b_press_t	= 0;				// The time of the last press event read from the queue
+		bool				b_long_rep	= false;			// The long press has been reported for the last press
 		GPIO_TypeDef* 		b_port	= 0;					// The PORT of the press button
 		GPIO_TypeDef*     	m_port	= 0;					// The PORT of the main channel
 		GPIO_TypeDef*		s_port	= 0;          			// The PORT of the secondary channel
 		uint16_t			b_pin	= 0;					// The PIN number of the button
 		uint16_t			m_pin	= 0;					// The PIN number of the main channel
 		uint16_t			s_pin	= 0;	    			// The PIN number of the secondary channel
-        const uint8_t     	trigger_on		= 100;			// avg limit to change button status to on
-        const uint8_t     	trigger_off 	= 50;			// avg limit to change button status to off
-        const uint8_t     	avg_length   	= 4;			// avg length
-        const uint8_t		b_check_period	= 20;			// The button check period, ms
+		const uint8_t		b_debounce		= 8;			// The button debounce time, ms
 		const uint16_t 		long_press		= 1500;			// If the button was pressed more that this timeout, we assume the long button press
 		const uint16_t		fast_timeout	= 300;			// Time in ms to change encoder quickly
 		const uint16_t		def_over_press	= 2500;			// Default value for button over press timeout (ms)
+		const uint8_t		rest_state		= 3;			// Both channels are open in the detent position
+		const uint16_t		accel_range		= 100;			// Minimal number of increments in the range to enable acceleration
+		const uint16_t		accel_reset		= 150;			// The interval between detents to stop acceleration, ms
+		static const int8_t	q_table[16];					// Quarter step direction by (previous state << 2) | new state
 };
 
 #endif
@@ -12,6 +12,7 @@
 #include "pid.h"
 #include "tools.h"
 #include "unit.h"
+#include "swtimer.h"
 
 #define FAN_TIM		htim2
 extern TIM_HandleTypeDef FAN_TIM;
@@ -19,9 +20,11 @@ extern TIM_HandleTypeDef FAN_TIM;
 class HOTGUN : public UNIT {
     public:
 		typedef enum { POWER_OFF, POWER_HEATING, POWER_ON, POWER_FIXED, POWER_COOLING, POWER_PID_TUNE } PowerMode;
-        HOTGUN(void) : h_power(hot_gun_hist_length), h_temp(hot_gun_hist_length) { }
+        HOTGUN(void)										{ }
         void        		init(void);
 		virtual bool		isOn(void)						{ return (mode == POWER_ON || mode == POWER_FIXED); }
+		PowerMode			powerMode(void)					{ return mode;									}
+		bool				isOverheat(void)				{ return avg_sync_temp >= int_temp_max + 100;	}
 		virtual uint16_t	presetTemp(void)				{ return temp_set; 								}
 		virtual uint16_t 	averageTemp(void)               { return avg_sync_temp; 						}
         virtual	uint16_t    getMaxFixedPower(void)			{ return max_fix_power; 						}
@@ -55,12 +58,14 @@ class HOTGUN : public UNIT {
 		bool		reach_cold_temp		= true;				// Flag indicating the Hot Air Gun has reached the 'temp_gun_cold' temperature
 		uint16_t	temp_set			= 0;				// The preset temperature of the hot air gun (internal units)
 		uint16_t	fan_speed			= 0;				// Preset fan speed
-		uint32_t	fan_off_time		= 0;				// Time when the fan should be powered off in cooling mode (ms)
-		EMP_AVERAGE	h_power;								// Exponential average of applied power
-		EMP_AVERAGE	h_temp;									// Exponential average of Hot Air Gun temperature
-		EMP_AVERAGE	d_power;								// Exponential average of power dispersion
-		EMP_AVERAGE d_temp;									// Exponential temperature math dispersion
-		EMP_AVERAGE	zero_temp;								// Exponential average of minimum (zero) temperature
+		SWTIMER		fan_off_timer;							// Power off the fan in cooling mode when expired
+		static const uint8_t	hist_length	= 10;			// The history data length of Hot Air Gun average values
+		static const uint8_t	ec			= 200;			// Exponential average coefficient of the dispersion
+		EMP<hist_length>	h_power;						// Exponential average of applied power
+		EMP<hist_length>	h_temp;							// Exponential average of Hot Air Gun temperature
+		EMP<ec>		d_power;								// Exponential average of power dispersion
+		EMP<ec>		d_temp;									// Exponential temperature math dispersion
+		EMP<8>		zero_temp;								// Exponential average of minimum (zero) temperature
 		volatile    uint16_t	avg_sync_temp	= 0;		// Average temperature synchronized with TIM1 (used to calculate required power, see power() method)
         const       uint8_t     max_fix_power 	= 70;
 		const		uint8_t		max_power		= 99;
@@ -14,6 +14,9 @@
 #include "encoder.h"
 #include "display.h"
 #include "config.h"
+#include "swtimer.h"
+#include "recorder.h"
+#include "usage.h"
 
 extern I2C_HandleTypeDef 	hi2c1;
 
@@ -24,11 +27,30 @@ class SCRSAVER {
 		void			reset(void);
 		bool 			scrSaver(void);
 	private:
-		uint32_t		scr_save_ms		= 0;				// Time to switch to Screen Saver mode (if > 0, ms)
+		SWTIMER			scr_timer;							// Switch to Screen Saver mode when expired
 		uint8_t			to				= 0;				// Timeout, minutes
 		bool			scr_saver		= false;			// Is the screen saver active
 };
 
+/*
+ * The display render scheduler. The modes do not keep the screen update time: they request
+ * the screen to be redrawn when the shown data changed and check whether the frame should be rendered now.
+ * Several requests are merged into one frame, the frames are rendered not often than min_interval.
+ * The rendering never starts just before TIM2 starts the ADC conversion (channel 3 and channel 4)
+ */
+class RENDER {
+	public:
+		RENDER(void)										{ }
+		void			request(void)						{ redraw = true; }
+		bool			due(uint16_t period);				// Whether the screen should be rendered now, period - refresh period in ms
+		bool			adcWindow(void);					// Whether the ADC conversion is about to start
+	private:
+		uint32_t		last_frame		= 0;				// The time in ms when the last frame was rendered
+		bool			redraw			= true;				// Whether the screen redraw was requested
+		const uint16_t	min_interval	= 20;				// Minimum time between two frames, ms (TIM2 period)
+		const uint16_t	adc_guard		= 200;				// Do not render the screen in this number of TIM2 ticks before ADC starts (2 ms)
+};
+
 class HW {
 	public:
 		HW(void) : cfg(&hi2c1),
@@ -41,6 +63,9 @@ class HW {
 		HOTGUN		hotgun;
 		BUZZER		buzz;
 		SCRSAVER	scrsaver;
+		RENDER		render;
+		FLREC		recorder;
+		USAGE		usage;
 };
 
 #endif
@@ -12,24 +12,34 @@
 #include "stat.h"
 #include "unit.h"
 
+#define IRON_KALMAN											// The PID input is the Kalman estimate of the temperature, see KALMAN in stat.h
+
 class IRON : public UNIT {
 	public:
 	typedef enum { POWER_OFF, POWER_ON, POWER_FIXED, POWER_COOLING, POWER_PID_TUNE } PowerMode;
-		IRON(void) 											{ }
+		IRON(void) : approach(approach_decimation)			{ }
 		void				init(void);
 		virtual void		switchPower(bool On);
 		virtual bool		isOn(void)						{ return (mode == POWER_ON); 					}
 		virtual uint16_t	presetTemp(void)				{ return temp_set; 								}
 		virtual uint16_t	averageTemp(void)				{ return h_temp.read(); 						}
 		virtual uint16_t 	tmpDispersion(void)				{ return d_temp.read(); 						}
+		bool				isSettled(uint16_t tolerance, uint8_t confidence)	{ return settle.settled(temp_set, tolerance, confidence); }
+		bool				predictTemp(int32_t *temp, uint16_t *bound)			{ return approach.predict(temp, bound); }
+		uint16_t			approachSamples(void)				{ return approach.samples(); }
+		bool				heatSignature(uint16_t *rise, uint8_t *early);		// True once when the heat-up signature is measured
+		bool				isSignatureBusy(void)			{ return sig_cnt > 0;							}
 		virtual uint16_t	pwrDispersion(void)             { return d_power.read(); 						}
 		virtual uint16_t    getMaxFixedPower(void)			{ return max_fix_power; 						}
 		virtual bool		isCold(void)					{ return (mode == POWER_OFF); 					}
+		PowerMode			powerMode(void)					{ return mode;									}
+		bool				isOverheat(void)				{ return temp_curr >= int_temp_max + 100;		}
 		int32_t				tempShortAverage(int32_t t)		{ return t_iron_short.average(t);				}
-		void				resetShortTemp(void)			{ t_iron_short.reset();							}
-		void				updateAmbient(uint32_t value)	{ t_amb.update(value);							}
+		void				resetShortTemp(void)			{ t_iron_short.reset(); kalman.reset();			}
+		void				updateAmbient(uint32_t value);
+		bool				isAmbientSettled(void)			{ return amb_samples >= ambient_settle;			}
 		uint16_t			ambientInternal(void)			{ return t_amb.read();							}
-		bool				noAmbientSensor(void)			{ return t_amb.read() >= max_ambient_value;		}
+		bool				noAmbientSensor(void)			{ return no_sensor;								}
 		uint16_t 			temp(void)						{ return temp_curr; 							}
 		int32_t				ambientTemp(void);
 		uint16_t			alternateTemp(void);					// Current temperature or 0 if cold
@@ -42,27 +52,52 @@ class IRON : public UNIT {
 		void				reset(void);							// Iron is disconnected, clear the temp history
 		void        		lowPowerMode(uint16_t t);				// Activate low power mode (preset temp.) To disable, use switchPower(true)
 	private:
+		int32_t				measureSignature(int32_t t, int32_t p);	// Called every TIM2 period while the signature is being measured
 		uint16_t 	temp_set			= 0;				// The temperature that should be kept
 		uint16_t	temp_low			= 0;				// The temperature in low power mode (if not zero)
 		uint16_t    fix_power			= 0;				// Fixed power value of the IRON (or zero if off)
 		volatile 	PowerMode	mode	= POWER_OFF;		// Working mode of the IRON
 		volatile 	bool chill			= false;			// Whether the IRON should be cooled (preset temp is lower than current)
 		volatile	uint16_t	temp_curr = 0;				// The actual IRON temperature
-		EMP_AVERAGE t_iron_short;							// Exponential average of the IRON temperature (short period)
-		EMP_AVERAGE t_amb;									// Exponential average of the ambient temperature
-		EMP_AVERAGE h_power;								// Exponential average of applied power
-		EMP_AVERAGE	h_temp;									// Exponential average of temperature
-		EMP_AVERAGE d_power;								// Exponential average of power math dispersion
-		EMP_AVERAGE d_temp;									// Exponential temperature math dispersion
+		volatile	uint8_t		amb_samples	= 0;			// The number of ambient temperature readings since initialization
+		volatile	uint8_t		amb_streak	= 0;			// The number of ambient readings in a row against the handle status
+		volatile	bool		no_sensor	= false;		// The ambient sensor is open, i.e. the IRON handle is disconnected
+		volatile	uint8_t		sig_cnt		= 0;			// The TIM2 periods since the heat-up signature started or 0 if not measured
+		volatile	int32_t		sig_t0		= 0;			// The temperature at the beginning of the signature interval
+		volatile	uint16_t	sig_rise	= 0;			// The measured heat-up signature, see heatSignature()
+		volatile	uint8_t		sig_early	= 0;
+		volatile	bool		sig_ready	= false;		// The heat-up signature is measured but not read yet
+		static const uint8_t	ec					= 20;	// Exponential average coefficient
+		static const uint8_t	ambient_emp_coeff	= 10;	// Exponential average coefficient for ambient temperature
+		static const uint8_t	iron_emp_coeff		= 8;	// Exponential average coefficient for IRON temperature
+		EMP<iron_emp_coeff>		t_iron_short;				// Exponential average of the IRON temperature (short period)
+		KALMAN					kalman;						// The estimate of the IRON temperature by the model of T12 tip
+		volatile	uint16_t	last_power	= 0;			// The power applied during the last TIM2 period
+		EMP<ambient_emp_coeff>	t_amb;						// Exponential average of the ambient temperature
+		EMP<ec>		h_power;								// Exponential average of applied power
+		EMP<ec>		h_temp;									// Exponential average of temperature
+		EMP<ec>		d_power;								// Exponential average of power math dispersion
+		EMP<ec>		d_temp;									// Exponential temperature math dispersion
+		SETTLE		settle;									// The temperature settled detector
+		SETTLE		approach;								// The long window to predict the final temperature
 		const uint16_t	max_power      		= 1999;			// Maximum power to the IRON
+		// The KALMAN model of T12 tip, checked against different tips by tools/kalman_sim.cpp
+		const uint32_t	model_loss			= 10066;		// The heat loss per TIM2 period, 6e-4 of the temperature, Q24
+		const uint32_t	model_gain			= 67109;		// The heating per TIM2 period, 4e-3 internal units per power unit, Q24
+		const uint32_t	model_q_temp		= 4096;			// The process noise of the temperature, Q16
+		const uint32_t	model_q_error		= 16;			// The process noise of the model error, Q16
+		const uint32_t	model_adc_noise		= 16 << 16;		// The variance of the readings, 4 units rms, Q16
 		const uint16_t	max_fix_power  		= 1000;			// Maximum power in fixed power mode
-		const uint8_t	ec	   				= 20;			// Exponential average coefficient
+		static const uint8_t approach_decimation = 32;		// Save every 32-th temperature to predict the final one (10 seconds window)
 		const uint16_t	iron_cold			= 100;			// The internal temperature when the IRON is cold
-		const uint8_t	ambient_emp_coeff	= 10;			// Exponential average coefficient for ambient temperature
-		const uint8_t	iron_emp_coeff		= 8;			// Exponential average coefficient for IRON temperature
+		const uint8_t	sig_skip			= 5;			// TIM2 periods before the signature window, the heat reaches the sensor
+		const uint8_t	sig_window			= 25;			// TIM2 periods of the heat-up signature window (0.5 seconds)
+		const uint16_t	sig_margin			= 400;			// Stop the signature if the temperature is closer to the preset one
+		const uint8_t	ambient_settle		= 4;			// The number of ambient readings to consider the average is stable
 		const uint16_t	iron_off_value		= 500;
 		const uint16_t	iron_on_value		= 1000;
 		const uint8_t	iron_sw_len			= 3;			// Exponential coefficient of current through the IRON switch
+		const uint8_t	connect_confirm		= 2;			// The number of readings in a row to detect the IRON or handle is connected or disconnected
 		const uint8_t	sw_off_value		= 14;
 		const uint8_t	sw_on_value			= 20;
 		const uint8_t	sw_avg_len			= 5;
@@ -91,6 +91,7 @@ void Error_Handler(void);
 #define GUN_REED_GPIO_Port GPIOA
 #define ENCODER_R_Pin GPIO_PIN_9
 #define ENCODER_R_GPIO_Port GPIOA
+#define ENCODER_R_EXTI_IRQn EXTI9_5_IRQn
 #define OLED_CS_Pin GPIO_PIN_10
 #define OLED_CS_GPIO_Port GPIOA
 #define GUN_POWER_Pin GPIO_PIN_11
@@ -38,8 +38,7 @@ class MODE {
 		bool			use_iron		= true;				// Active 'tip': soldering iron or hot air gun
 		HW*				pCore			= 0;
 		uint16_t		timeout_secs	= 0;				// Timeout to return to main mode, seconds
-		uint32_t		time_to_return 	= 0;				// Time in ms when to return to the main mode
-		uint32_t		update_screen	= 0;				// Time in ms when the screen should be updated
+		SWTIMER			time_to_return;						// Return to the main mode when expired
 		MODE*			mode_return		= 0;				// Previous working mode
 		MODE*			mode_spress		= 0;				// When encoder button short pressed
 		MODE*			mode_lpress		= 0;				// When encoder button long  pressed
@@ -55,7 +54,7 @@ class MSTBY_IRON : public MODE {
 		void			setGunMode(MWORK_GUN* gw)			{ gun_work = gw; }
 	private:
 		MWORK_GUN*		gun_work		= 0;				// Hot Air Gun Work mode
-		uint32_t		clear_used_ms	= 0;				// Time in ms when used flag should be cleared (if > 0)
+		SWTIMER			clear_used;							// Clear the used flag when expired
 		bool			used			= false;			// Whether the IRON was used (was hot)
 		bool			cool_notified	= 0;				// Whether there was cold notification played
 		bool			no_handle		= false;			// Whether soldering iron handle disconnected (no ambient sensor)
@@ -76,14 +75,19 @@ class MWORK_IRON : public MODE {
 		void 			swTimeout(uint16_t temp, uint16_t temp_set, uint16_t temp_setH, uint32_t td, uint32_t pd, uint16_t ap);
 		MWORK_GUN*		gun_work		= 0;				// Hot Air Gun Standby mode
 		MODE*			low_power_mode	= 0;				// Low power mode pointer
-		EMP_AVERAGE  	idle_pwr;							// Exponential average value for idle power
+		static const uint8_t ec			= 5;				// The exponential average coefficient
+		EMP<ec>		  	idle_pwr;							// Exponential average value for idle power
 		bool 			auto_off_notified = false;			// The time (in ms) when the automatic power-off was notified
 		bool      		ready			= false;			// Whether the IRON have reached the preset temperature
-		uint32_t		ready_clear		= 0;				// Time when to clean 'Ready' message
-		uint32_t		lowpower_time	= 0;				// Time when switch to standby power mode
+		SWTIMER			ready_clear;						// Clean 'Ready' message when expired
+		SWTIMER			lowpower_timer;						// Switch to standby power mode when expired
+		SWTIMER			hold_timer;							// Sample the holding power when fired
+		bool			tilt			= false;			// The tilt switch was active at the last screen update
 		uint16_t 		old_temp_set	= 0;
 		const uint16_t	period			= 500;				// Redraw display period (ms)
-		const uint8_t	ec				= 5;				// The exponential average coefficient
+		const uint16_t	hold_period		= 500;				// The holding power sampling period (ms), see USAGE::base_samples
+		const uint16_t	ready_tolerance	= 6;				// The IRON is ready when the temperature settled inside this tolerance (internal units)
+		const uint8_t	ready_confidence= 10;				// with this confidence level (z-score * 10)
 };
 
 //-------------------- The iron low power mode, decrease iron temperature --------
@@ -116,9 +120,19 @@ class MSLCT : public MODE {
 		virtual void	init(void);
 		virtual MODE*	loop(void);
 	private:
+		typedef enum { SLCT_WAIT, SLCT_HEAT, SLCT_CONFIRM } SlctPhase;
+		MODE*			selectTip(uint8_t tip_index);		// Change the tip and return to the main mode
+		void			preselect(uint8_t tip_index);		// Show the identified tip in the list
 		TIP_ITEM		tip_list[3];
 		uint32_t 		tip_begin_select	= 0;			// The time in ms when we started to select new tip
+		SWTIMER			confirm_timer;						// Select the identified tip when expired
+		SlctPhase		phase				= SLCT_WAIT;	// Waiting for the tip, measuring the heat-up signature or confirming the identified tip
+		uint16_t		sig_rise			= 0;			// The heat-up signature of the inserted tip, see IRON::heatSignature()
+		uint8_t			sig_early			= 0;
+		uint8_t			shown_tip			= 0;			// The tip index selected in the list or 0 before the list is shown
+		bool			chosen				= false;		// The operator has chosen the tip by the rotary encoder
 		uint8_t 		old_index = 3;
+		const uint32_t	confirm_timeout		= 3000;			// The time to confirm the identified tip or to choose another one, ms
 };
 
 //---------------------- The Activate tip mode: select tips to use ---------------
@@ -214,17 +228,25 @@ class MCALIB : public MODE {
 		virtual void	init(void);
 		virtual MODE*	loop(void);
 	private:
-		bool 		calibrationOLS(uint16_t* tip, uint16_t min_temp, uint16_t max_temp);
-		uint8_t		closestIndex(uint16_t temp);
+		uint8_t		calibrationOLS(uint16_t* tip, uint16_t min_temp, uint16_t max_temp);	// The polynomial degree or 0
 		void 		updateReference(uint8_t indx);
 		void 		buildFinishCalibration(void);
+		void		acceptReference(void);
+		MODE*		nextReference(void);
 		uint8_t		ref_temp_index	= 0;					// Which temperature reference to change: [0-MCALIB_POINTS]
 		uint16_t	calib_temp[2][MCALIB_POINTS];			// The calibration data: real temp. [0] and temp. in internal units [1]
 		uint16_t	tip_temp_max	= 0;					// the maximum possible tip temperature in the internal units
 		bool		ready			= false;				// Whether the temperature has been established
 		bool		tuning			= false;
+		bool		refine			= false;				// The predicted temperature was entered, wait for the settled one to ask again
 		int16_t		old_encoder 	= 3;
+		uint16_t	predicted		= 0;					// The predicted final temperature (internal units) or zero
+		uint8_t		confirmed		= 0;					// The number of the predictions in a row that agree
+		uint16_t	last_sample		= 0;					// The approach sample counter when the prediction was checked last time
+		const uint8_t  predict_confirm = 6;					// The number of the agreed predictions to use the predicted temperature
 		const uint16_t start_int_temp = 600;				// Minimal temperature in internal units, about 100 degrees Celsius
+		const uint16_t settle_tolerance = 8;				// The real temperature can be entered when the temperature settled inside this tolerance
+		const uint8_t  settle_confidence = 20;				// with this confidence level (z-score * 10)
 };
 
 //---------------------- The calibrate tip mode: manual calibration --------------
@@ -240,7 +262,7 @@ class MCALIB_MANUAL : public MODE {
 		uint16_t	calib_temp[4];							// The calibration temp. in internal units in reference points
 		bool		ready			= 0;					// Whether the temperature has been established
 		bool		tuning			= 0;					// Whether the reference temperature is modifying (else we select new reference point)
-		uint32_t	temp_setready_ms	= 0;				// The time in ms when we should check the temperature is ready
+		SWTIMER		temp_setready;							// Check the temperature is ready when fired
 		int16_t		old_encoder 	= 4;
 		uint16_t	fan_speed		= 1500;					// The Hot Air Gun fan speed during calibration
 };
@@ -274,7 +296,7 @@ class MTUNE : public MODE {
 		uint16_t 	old_power 		= 0;
 		bool		powered   		= true;
 		bool		check_connected	= false;				// Flag indicating to check IRON or Hot Air Gun is connected
-		uint32_t	check_delay		= 0;					// Time in ms when to start checking Hot Air Gun is connected
+		SWTIMER		check_delay;							// Start checking the Hot Air Gun is connected when fired
 };
 
 //---------------------- The PID coefficients tune mode --------------------------
@@ -284,8 +306,8 @@ class MTPID : public MODE {
 		virtual void	init(void);
 		virtual MODE*	loop(void);
 	private:
-		uint32_t	data_update	= 0;						// When read the data from the sensors (ms)
-		uint32_t	temp_setready_ms	= 0;				// The time in ms when we should check the temperature is ready
+		SWTIMER		data_update;							// Read the data from the sensors periodically
+		SWTIMER		temp_setready;							// Check the temperature is ready when fired
 		uint8_t		data_index	= 0;						// Active coefficient
 		bool        modify		= 0;						// Whether is modifying value of coefficient
 		bool		on			= 0;						// Whether the IRON is turned on
@@ -306,9 +328,9 @@ class MWORK_GUN : public MODE, SCRSAVER {
 		uint32_t 		old_param		= 0;
 		bool			edit_temp		= true;				// The rotary encoder is changing the temperature preset
 		bool      		ready			= false;			// Whether the Hot Air Gun have reached the preset temperature
-		uint32_t		return_to_temp	= 0;				// The time when to return to change the temperature
-		uint32_t		ready_clear		= 0;				// Time when to clean 'Ready' message
-		uint32_t		fan_animate		= 0;				// Time when draw new fan animation
+		SWTIMER			return_to_temp;						// Return to change the temperature when expired
+		SWTIMER			ready_clear;						// Clean 'Ready' message when expired
+		SWTIMER			fan_animate;						// Draw new fan animation when fired
 		uint8_t			fan_angle		= 0;				// Current angle of fan icon [0..3]
 		bool			keep_iron		= false;			// Keep iron working while in Hot Air Gun mode
 		const uint16_t	edit_fan_timeout = 3000;			// The time to edit fan speed (ms)
@@ -342,12 +364,33 @@ class MFAIL : public MODE {
 		virtual MODE*	loop(void);
 };
 
+//---------------------- The Flight recorder mode: browse the last control cycles -
+class MFLREC : public MODE {
+	public:
+		MFLREC(HW *pCore) : MODE(pCore)						{ }
+		virtual void	init(void);
+		virtual MODE*	loop(void);
+	private:
+		MODE*			leave(void);						// Return to the main mode, unfreeze the recorder
+		uint16_t		old_cursor		= 0;				// Previous encoder position
+		bool			dump			= false;			// Whether the records are being dumped to the host
+		uint8_t			dump_index		= 0;				// The next record to be dumped
+		const char*		note			= 0;				// The message shown instead of the record data
+		SWTIMER			dump_stall;							// Stop dumping if the host does not read the stream
+		SWTIMER			idle;								// Return to the main mode if the encoder is not used
+		const uint16_t	cycle_ms		= 20;				// The control cycle period, one record per cycle
+		const uint16_t	stall_timeout	= 2000;				// The time to wait for the host reading the stream, ms
+		const uint32_t	idle_timeout	= 300000;			// The idle time to return to the main mode, ms
+};
+
 //---------------------- The About dialog mode. Show about message ---------------
 class MABOUT : public MODE {
 	public:
 		MABOUT(HW *pCore) : MODE(pCore)						{ }
 		virtual void	init(void);
 		virtual MODE*	loop(void);
+	private:
+		uint8_t			page			= 0;				// 0 - version, 1 - startup time, 2 - usage statistics
 };
 
 //---------------------- The Debug mode: display internal parameters ------------
@@ -24,4 +24,11 @@ extern "C" uint8_t u8x8_gpio_and_delay_stm32(u8x8_t *u8x8, uint8_t msg, uint8_t
 extern "C" uint8_t u8x8_byte_stm32_hw_spi(u8x8_t *u8g2, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 extern "C" uint8_t u8x8_byte_stm32_hw_i2c(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 
+// Send the frame by DMA: record the transfers between oledTransferBegin() and oledTransferCommit()
+void	oledTransferBegin(void);
+void	oledTransferCommit(void);
+bool	oledBusy(void);
+void	oledWait(void);
+bool	oledAborted(void);									// The last frame was not sent completely
+
 #endif
@@ -43,6 +43,7 @@ class PID {
 		int32_t 	reqPower(int16_t temp_set, int16_t temp_curr);
 		int32_t  	changePID(uint8_t p, int32_t k);    	// set or get (if parameter < 0) PID parameter
 		void		newPIDparams(uint16_t delta_power, uint32_t diff, uint32_t period);
+		void		pidTerms(int32_t &p, int32_t &i, int32_t &d)	{ p = term_p; i = term_i; d = term_d;	}
 	private:
 		void  		debugPID(int t_set, int t_curr, long kp, long ki, long kd, long delta_p);
 		uint32_t 	T 				= 20;					// Check IRON or Hot Air Gun period, ms (to calculate auto PID parameters)
@@ -56,6 +57,9 @@ class PID {
 		int32_t		Ki_force		= 5;					// Ki / 10
 		int16_t  	denominator_p	= 11;              		// The common coefficient denominator power of 2 (11 means 2048)
 		bool		use_force		= true;					// Flag indicating to use forcibly heating mode
+		int32_t		term_p			= 0;					// The PID terms of the last power calculation, used by telemetry
+		int32_t		term_i			= 0;
+		int32_t		term_d			= 0;
 };
 
 class PIDTUNE {
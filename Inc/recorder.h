@@ -0,0 +1,46 @@
+/*
+ * recorder.h
+ *
+ *  Flight recorder: the last control cycles before the failure
+ */
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include "main.h"
+
+#define FLREC_SIZE		(64)								// The number of the records, one per control cycle (20 ms). Should be a power of 2
+
+typedef enum { FLR_IRON_CONN = 1, FLR_GUN_CONN = 2, FLR_IRON_HOT = 4, FLR_GUN_HOT = 8 } FLREC_FLAGS;
+
+typedef struct __attribute__((packed)) s_flrec_entry {
+	uint16_t	iron_temp;									// IRON temperature (internal units)
+	uint16_t	iron_pwm;									// Applied IRON power, TIM2->CCR1
+	uint16_t	gun_temp;									// Hot Air Gun temperature (internal units)
+	uint16_t	gun_pwm;									// Applied Hot Air Gun power, TIM1->CCR4
+	uint16_t	fan_pwm;									// Hot Air Gun fan duty, TIM2->CCR2
+	uint8_t		mode;										// IRON power mode | (Hot Air Gun power mode << 4)
+	uint8_t		flags;										// FLREC_FLAGS
+} FLREC_ENTRY;
+
+/*
+ * The ring buffer is written by the ADC interrupt handler only, so it needs no lock.
+ * When frozen, the interrupt handler stops writing and the data can be read safely
+ */
+class FLREC {
+	public:
+		FLREC(void)											{ }
+		void			add(const FLREC_ENTRY &e);			// Called from the ADC interrupt handler
+		void			freeze(void)						{ frozen = true;	}
+		void			unfreeze(void)						{ frozen = false;	}
+		bool			isFrozen(void)						{ return frozen;	}
+		uint8_t			size(void)							{ return count;		}
+		const FLREC_ENTRY&	read(uint8_t index);			// The record by index, 0 is the oldest one
+	private:
+		FLREC_ENTRY			data[FLREC_SIZE];
+		volatile uint8_t	head	= 0;					// The position of next record
+		volatile uint8_t	count	= 0;					// The number of records in the buffer
+		volatile bool		frozen	= false;				// The buffer is not updated when frozen
+};
+
+#endif
@@ -15,6 +15,7 @@ class EMP_AVERAGE {
 		EMP_AVERAGE(uint8_t h_length = 8)				{ emp_k = h_length; emp_data = 0; }
 		void			length(uint8_t h_length)		{ emp_k = h_length; emp_data = 0; }
 		void			reset(void)						{ emp_data = 0; }
+		void			preset(int32_t value)			{ emp_data = value * emp_k; }	// Start averaging from the value
 		int32_t			average(int32_t value);
 		void			update(int32_t value);
 		int32_t			read(void);
@@ -23,13 +24,62 @@ class EMP_AVERAGE {
 		volatile	uint32_t	emp_data	= 0;
 };
 
+/*
+ * Exponential average with the coefficient known at compile time. The compiler replaces the division
+ * by the constant with the shift (K is a power of two) or with the multiplication and the shift,
+ * so the filter is cheap enough for the interrupt handlers. The results are the same as EMP_AVERAGE ones
+ */
+template <uint8_t K> class EMP {
+	public:
+		EMP(void)										{ }
+		void			reset(void)						{ emp_data = 0; }
+		void			preset(int32_t value)			{ emp_data = value * K; }	// Start averaging from the value
+		int32_t			average(int32_t value)			{ update(value); return read(); }
+		void			update(int32_t value)			{ emp_data += value - (emp_data + round_v) / K; }
+		int32_t			read(void)						{ return (emp_data + round_v) / K; }
+	private:
+		uint32_t		emp_data	= 0;
+		static const uint32_t	round_v = K >> 1;
+};
+
+/*
+ * Kalman filter of the heater temperature. The state is the temperature T and the model error d (the unknown
+ * temperature change per step), the applied power P is the process input, the ADC reading z is the measurement:
+ * T(n+1) = (1 - loss) * T(n) + gain * P(n) + d(n),	d(n+1) = d(n),	z(n) = T(n) + noise
+ * The state is Q16, the covariances are Q16 (internal units^2), loss and gain are Q24 per step.
+ * IRON::power() uses the estimate as the PID input when IRON_KALMAN is defined (iron.h). tools/kalman_sim.cpp
+ * compares it with the exponential average of the readings for different tips
+ */
+class KALMAN {
+	public:
+		KALMAN(void)										{ }
+		void			setup(uint32_t loss, uint32_t gain, uint32_t q_temp, uint32_t q_model, uint32_t r);
+		void			reset(void)							{ ready = false; }
+		int32_t			update(int32_t z, uint16_t power);	// Returns the estimated temperature
+		int32_t			read(void)							{ return (t + (1 << 15)) >> 16; }
+	private:
+		int32_t			t			= 0;					// The estimated temperature, Q16
+		int32_t			d			= 0;					// The estimated model error per step, Q16
+		int64_t			p00 = 0, p01 = 0, p11 = 0;			// The covariance matrix, Q16
+		uint32_t		a			= 0;					// The heat loss coefficient, Q24
+		uint32_t		b			= 0;					// The heating coefficient, Q24
+		uint32_t		q_t			= 0;					// The process noise of the temperature, Q16
+		uint32_t		q_d			= 0;					// The process noise of the model error, Q16
+		uint32_t		r_z			= 0;					// The measurement noise, Q16
+		bool			ready		= false;				// The filter was initialized by the first measurement
+};
+
 #define H_LENGTH (16)
-// Flat history data with round buffer
+/*
+ * Flat history data with round buffer. The sum and the sum of squares of the queue are updated when the value
+ * is added, so read() and dispersion() do not loop over the queue. The sums are kept modulo 2^32,
+ * the results are the same as the direct summation in 32-bit arithmetic
+ */
 class HIST {
 	public:
-    	HIST(uint8_t h_length = H_LENGTH)				{ len = index = 0; max_len = h_length; }
-    	void			length(uint8_t h_length)		{ len = index = 0; if (h_length > H_LENGTH) h_length = H_LENGTH; max_len = h_length; }
-    	void			reset()							{ len = index = 0; }
+    	HIST(uint8_t h_length = H_LENGTH)				{ max_len = h_length; reset(); }
+    	void			length(uint8_t h_length)		{ if (h_length > H_LENGTH) h_length = H_LENGTH; max_len = h_length; reset(); }
+    	void			reset()							{ len = index = 0; sum = 0; sum_sq = 0; }
     	int32_t			read(void);
     	int32_t			average(int32_t value);
     	void			update(int32_t value);
@@ -39,16 +89,81 @@ class HIST {
     	volatile uint8_t	len;						// The number of elements in the queue
     	volatile uint8_t	max_len;					// Maximum length of the queue, not greater than H_LENGTH
     	volatile uint8_t 	index;						// The current element position, use ring buffer
+    	volatile uint32_t	sum;						// The sum of the queue elements
+    	volatile uint32_t	sum_sq;						// The sum of squares of the queue elements
 };
 
+#define POLY_MAX_DEGREE	(3)
+#define POLY_MAX_POINTS	(16)
+/*
+ * Least squares polynomial fit Y = c0 + c1*t + c2*t^2 + c3*t^3 in fixed point arithmetic.
+ * The argument is normalized to t = (X - x_center) / x_scale, so t is in [-1, 1] inside the fitted interval (Q20),
+ * the coefficients are Q16. Outside the fitted interval the polynomial is extrapolated linearly.
+ * Y values are 12-bit ADC readings, the 64-bit sums do not overflow for up to POLY_MAX_POINTS points
+ */
+class POLYFIT {
+	public:
+		POLYFIT(void)										{ }
+		bool			fit(const uint16_t x[], const uint16_t y[], uint8_t n, uint8_t degree);
+		int32_t			value(int32_t x);
+		uint8_t			degree(void)						{ return deg; }
+	private:
+		int32_t			poly(int32_t x);					// The polynomial value inside the fitted interval
+		int32_t			normalize(int32_t x)				{ return ((int64_t)(x - x_center) << q) / x_scale; }
+		int32_t			c[POLY_MAX_DEGREE+1]	= { 0 };	// The polynomial coefficients, Q16
+		int32_t			x_center		= 0;
+		int32_t			x_scale			= 1;
+		int32_t			x_min			= 0;
+		int32_t			x_max			= 0;
+		uint8_t			deg				= 0;
+		const uint8_t	q				= 20;				// The fixed point precision of the normalized argument
+		const int64_t	min_pivot		= 512;				// The matrix is singular if the pivot is smaller (Q20)
+};
+
+#define SETTLE_WINDOW	(16)
+/*
+ * The temperature settled detector. The linear regression over the sliding window of the samples gives
+ * the temperature drift and the residual noise. The temperature is settled when the mean deviation from the target
+ * and the drift over the window are inside the tolerance with the required confidence level,
+ * i.e. adding 'confidence' standard errors of the estimations does not exceed the tolerance.
+ * update() is called from the interrupt handler every control cycle, every 'decimation' value is saved in the window
+ */
+class SETTLE {
+	public:
+		SETTLE(uint8_t decimation = 8)						{ dec = decimation; }
+		void			reset(void)							{ len = index = 0; }
+		uint16_t		samples(void)						{ return count; }
+		void			update(int32_t value);
+		bool			settled(int32_t target, uint16_t tolerance, uint8_t confidence);	// confidence - z-score * 10
+		bool			predict(int32_t *final, uint16_t *bound);	// Predict the final value of the exponential approach
+	private:
+		bool			copy(int32_t y[]);					// Copy the window, the oldest sample first
+		bool			aitken(int32_t y[], int32_t *final, uint32_t *sigma);
+		volatile int32_t	queue[SETTLE_WINDOW];
+		volatile uint8_t	len			= 0;				// The number of samples in the window
+		volatile uint8_t	index		= 0;				// The position of the next sample (the oldest one when the window is full)
+		volatile uint8_t	skip		= 0;				// The number of skipped values since the last sample
+		volatile uint16_t	count		= 0;				// The number of samples saved since power on, wraps around
+		uint8_t				dec			= 8;
+		uint32_t			noise2		= 0;				// The noise variance of the samples in the window, Q8
+		const uint8_t		group		= SETTLE_WINDOW/3;	// The number of samples averaged in each point of the Aitken method
+};
+
+/*
+ * The switch with hysteresis over the exponential average of the readings. If 'confirm' is not zero,
+ * the status also changes when 'confirm' raw readings in a row are beyond the threshold, so the long average
+ * does not delay the detection of the hard status change
+ */
 class SWITCH : public EMP_AVERAGE {
     public:
         SWITCH(uint8_t len=8) : EMP_AVERAGE(len)			{ }
-        void        init(uint8_t h_len, uint16_t on = 500, uint16_t off = 500);
+        void        init(uint8_t h_len, uint16_t on = 500, uint16_t off = 500, uint8_t confirm = 0);
         bool        status(void)							{ return mode; }
         bool		changed(void);
         void		update(uint16_t value);
     private:
+        uint8_t		confirm_n	= 0;						// The number of raw readings in a row to change the status (0 - disabled)
+        uint8_t		streak		= 0;						// The number of raw readings in a row against the current status
         bool		sw_changed	= false;					// The status has changed flag
         bool        mode	= false;               			// The switch mode on (true)/off
         int16_t    	on_val  = 400;                 			// Turn on  value
@@ -0,0 +1,51 @@
+/*
+ * swtimer.h
+ *
+ *  Software timers served by the timer wheel
+ */
+
+#ifndef SWTIMER_H_
+#define SWTIMER_H_
+
+#include "main.h"
+
+#define SWTIMER_SLOTS	(64)								// The timer wheel size, should be a power of 2
+
+typedef void (*SWTIMER_CB)(void *arg);
+
+/*
+ * The timer is linked into the wheel slot of its expiration time (ms) modulo the wheel size.
+ * swTimerTick() advances the wheel every ms and walks through the current slot only,
+ * so start() and cancel() do not depend on the number of timers.
+ * The time is 64-bit milliseconds counter, the timers never wrap.
+ * The expired timer raises the flag read by expired() and calls the callback function if any.
+ * The callback is called from SysTick interrupt handler, keep it short.
+ */
+class SWTIMER {
+	public:
+		SWTIMER(SWTIMER_CB cb = 0, void *arg = 0)			{ this->cb = cb; cb_arg = arg; }
+		void			start(uint32_t delay_ms, uint32_t period_ms = 0);	// (Re)arm the timer. Periodic timer if period_ms > 0
+		void			cancel(void);
+		bool			expired(void);						// True once after the timer expired, clears the expired flag
+		bool			isActive(void)						{ return linked || fired; }	// Armed or expired but not checked yet
+		bool			isFired(void)						{ return fired; }	// The timer expired, the flag is not cleared
+		uint32_t		remaining(void);					// Time in ms till the timer expiration
+	private:
+		void			link(void);
+		void			unlink(void);
+		void			fire(void);
+		SWTIMER			*next		= 0;					// The next timer in the wheel slot
+		SWTIMER			*prev		= 0;					// The previous timer in the wheel slot
+		uint64_t		expire		= 0;					// The expiration time, ms
+		uint32_t		period		= 0;					// The period of periodic timer, ms
+		SWTIMER_CB		cb			= 0;					// The function to be called when the timer expires
+		void			*cb_arg		= 0;					// The callback function argument
+		volatile bool	linked		= false;				// Whether the timer is in the wheel
+		volatile bool	fired		= false;				// The timer expired flag
+	friend void swTimerTick(void);
+};
+
+uint64_t	swTime(void);									// The time since start, ms
+void		swTimerTick(void);								// Advance the timer wheel, called from SysTick every ms
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * telemetry.h
+ *
+ *  Binary telemetry stream of the control cycles
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "main.h"
+
+#define TLM_VERSION		(1)									// The record layout version, increment when the record changed
+#define TLM_FLIGHT		(0x10)								// The frame type of the flight recorder entry, see tlmSendData()
+#define TLM_BUFF_SIZE	(1024)								// The stream buffer size, should be a power of 2
+
+/*
+ * The telemetry record of one control cycle (TIM2 period, 20 ms), little endian.
+ * The record is protected by CRC16-CCITT, encoded by COBS and terminated by zero byte.
+ * See tools/telemetry.py to decode the stream.
+ */
+typedef struct __attribute__((packed)) s_tlm_record {
+	uint8_t		version;									// TLM_VERSION
+	uint8_t		mode;										// IRON power mode | (Hot Air Gun power mode << 4)
+	uint16_t	seq;										// The record sequence number, used to detect lost records
+	uint32_t	time;										// The time since start, ms
+	uint16_t	iron_raw;									// IRON temperature, raw ADC value
+	uint16_t	iron_temp;									// IRON temperature, filtered (internal units)
+	uint16_t	iron_set;									// IRON preset temperature (internal units)
+	uint16_t	iron_pwm;									// Applied IRON power, TIM2->CCR1
+	int32_t		pid_p;										// PID terms of the last IRON power calculation
+	int32_t		pid_i;
+	int32_t		pid_d;
+	uint16_t	gun_temp;									// Hot Air Gun temperature, filtered (internal units)
+	uint16_t	gun_set;									// Hot Air Gun preset temperature (internal units)
+	uint16_t	gun_pwm;									// Applied Hot Air Gun power, TIM1->CCR4
+	uint16_t	fan_pwm;									// Hot Air Gun fan duty, TIM2->CCR2
+	uint16_t	ambient;									// Ambient temperature, raw ADC value
+} TLM_RECORD;
+
+bool		tlmSend(TLM_RECORD *rec);						// Put the record to the stream, called from the ADC interrupt
+bool		tlmSendData(uint8_t type, const void *data, uint8_t size);	// Put the frame of specified type to the stream
+uint32_t	tlmDropped(void);								// The number of records lost because the host does not read the stream
+uint32_t	tlmRejected(void);								// The number of tlmSendData() calls failed because the stream buffer was full
+
+#endif
@@ -17,8 +17,17 @@
 int32_t 	map(int32_t value, int32_t v_min, int32_t v_max, int32_t r_min, int32_t r_max);
 int32_t		constrain(int32_t value, int32_t min, int32_t max);
 uint8_t 	gauge(uint8_t percent, uint8_t p_middle, uint8_t g_max);
+uint32_t	isqrt(uint64_t value);
 
 int16_t 	celsiusToFahrenheit(int16_t cels);
 int16_t		fahrenheitToCelsius(int16_t fahr);
 
+// Light replacement of sprintf(). The functions return the pointer to the terminating zero, so the calls can be chained
+char*		fmtInt(char *buff, int32_t value, uint8_t width = 0, char fill = ' ');	// Right aligned integer in the field of width
+char*		fmtStr(char *buff, const char *str, uint8_t width = 0);				// Left aligned string in the field of width
+
+void		cycleCounterInit(void);
+uint32_t	cycleCounter(void);
+uint32_t	cyclesToUs(uint32_t cycles);
+
 #endif
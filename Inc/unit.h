@@ -13,10 +13,11 @@ class UNIT : public PID, public PIDTUNE {
 	public:
 		UNIT(void)											{ }
 		virtual				~UNIT(void)						{ }
-		void				init(uint8_t c_len, uint16_t c_min, uint16_t c_max, uint8_t s_len, uint16_t s_min, uint16_t s_max);
+		void				init(uint8_t c_len, uint16_t c_min, uint16_t c_max, uint8_t s_len, uint16_t s_min, uint16_t s_max, uint8_t c_confirm = 0);
 		bool				isConnected(void) 				{ return current.status();						}
 		uint16_t			unitCurrent(void)				{ return current.read();						} // Used in debug mode only
-		void				updateCurrent(uint16_t value) 	{ current.update(value);						}
+		void				updateCurrent(uint16_t value) 	{ current.update(value); if (c_samples < 255) ++c_samples; }
+		bool				isCurrentSettled(void)			{ return c_samples >= c_settle;					}
 		uint16_t			reedInternal(void)				{ return sw.read();								}
 		void				updateReedStatus(bool on)		{ sw.update(on?100:0);							} // Update Reed switch status
 		bool 				isReedSwitch(bool reed);	// REED switch: TRUE if switch is shorten; else: TRUE if status has been changed
@@ -35,6 +36,8 @@ class UNIT : public PID, public PIDTUNE {
 	private:
 		SWITCH 			current;							// The current through the unit
 		SWITCH 			sw;									// Tilt switch of T12 or Reed switch of Hot Air Gun
+		volatile uint8_t	c_samples	= 0;				// The number of current checks since initialization
+		uint8_t			c_settle		= 0;				// The number of current checks to get reliable switch status
 };
 
 #endif
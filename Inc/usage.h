@@ -0,0 +1,74 @@
+/*
+ * usage.h
+ *
+ *  Usage statistics of the tips and the Hot Air Gun
+ */
+
+#ifndef USAGE_H_
+#define USAGE_H_
+
+#include "main.h"
+#include "config.h"
+#include "stat.h"
+
+/*
+ * The control cycle data are accumulated by cycle() in the ADC interrupt handler.
+ * The main loop adds the accumulated data to the totals in RAM and saves the totals into the statistics area
+ * of the EEPROM when the change is significant, when the tip has been changed or when the AC power is lost.
+ * The statistics area keeps 16 tips; the 17-th tip overwrites the history of the tip saved least recently,
+ * the usage page of the About dialog shows the name of that tip.
+ * The power required to keep the tip temperature in the steady state grows as the tip wears out. The first samples of
+ * the holding power build the baseline of the fresh tip, the tip health is the drift of the actual holding power from it.
+ * The heat-up signature of every calibrated tip is averaged over the heat-ups of the cold tip. The inserted tip is identified
+ * as the tip with the closest signature
+ */
+class USAGE {
+	public:
+		USAGE(void)											{ }
+		void			init(CFG *pCFG);
+		void			cycle(bool iron_on, uint16_t iron_pwm, bool gun_on);	// Called every control cycle from ADC interrupt
+		void			update(CFG *pCFG, bool power_lost);	// Called periodically from the main loop
+		void			holdPower(uint16_t power, int16_t delta);	// The steady state power, delta - temperature above ambient (Celsius)
+		int8_t			health(void);						// The tip health in percent or -1 if the baseline is not ready
+		void			heatSignature(uint16_t rise, uint8_t early);	// The heat-up signature of the current tip, see IRON::heatSignature()
+		bool			canIdentify(CFG *pCFG);				// At least one calibrated tip has the heat-up signature
+		int16_t			identify(CFG *pCFG, uint16_t rise, uint8_t early);	// The tip index with the closest signature or -1
+		const STATS&	tipStats(void)						{ return tip;		}
+		uint32_t		gunSec(void)						{ return gun_sec;	}
+		uint16_t		gunCycles(void)						{ return gun_cycles;}
+	private:
+		void			collect(void);
+		void			loadTip(CFG *pCFG, uint8_t tip_index);
+		void			save(CFG *pCFG);
+		bool			loadSignature(CFG *pCFG, uint8_t n, STATS *st);	// Load n-th statistics record if it has the usable signature
+		STATS				tip;							// The totals of the current tip
+		uint32_t			gun_sec			= 0;			// The Hot Air Gun totals
+		uint16_t			gun_cycles		= 0;
+		uint32_t			iron_ms			= 0;			// The time not saved yet, ms
+		uint32_t			gun_ms			= 0;
+		uint64_t			energy_rest		= 0;			// The energy not added to the totals yet, pwm * W * ms
+		uint32_t			unsaved_ms		= 0;			// The working time since the totals were saved, ms
+		static const uint8_t hold_k			= 32;			// The exponential average coefficient of the holding power
+		EMP<hold_k>			hold_avg;						// The exponential average of the holding power
+		bool				dirty			= false;		// The totals differ from the saved ones
+		bool				loaded			= false;		// The totals were loaded from the EEPROM
+		// The data accumulated by the interrupt handler
+		volatile uint32_t	c_iron_ms		= 0;
+		volatile uint32_t	c_gun_ms		= 0;
+		volatile uint32_t	c_pwm			= 0;			// The sum of the applied IRON power
+		volatile uint16_t	c_iron_cycles	= 0;
+		volatile uint16_t	c_gun_cycles	= 0;
+		volatile bool		iron_was_on		= false;
+		volatile bool		gun_was_on		= false;
+		const uint16_t		cycle_ms		= 20;			// The control cycle period, ms
+		const uint16_t		pwm_full		= 2000;			// TIM2 period, the full IRON power
+		const uint16_t		iron_watts		= 72;			// Nominal power of T12 heater (8 Ohm at 24 volts)
+		const uint32_t		save_period		= 15*60*1000;	// Save the totals after this working time, ms
+		const uint8_t		base_samples	= 240;			// The holding power samples in the baseline (2 minutes of steady state)
+		const int16_t		min_delta		= 100;			// Minimum temperature above ambient to check the holding power
+		const uint8_t		sig_samples		= 4;			// The number of heat-ups averaged in the signature, then the signature follows the tip wear
+		const uint8_t		early_floor		= 8;			// Added to the early rise to compare the small values
+		const uint16_t		match_limit		= 12;			// The maximum signature difference of the identified tip, percent
+};
+
+#endif
@@ -12,8 +12,6 @@
 
 extern const uint16_t	int_temp_max;
 extern const uint8_t	auto_pid_hist_length;
-extern const uint8_t	hot_gun_hist_length;
-extern const uint8_t	ec;
 
 extern const uint16_t	iron_temp_minC;
 extern const uint16_t 	iron_temp_maxC;
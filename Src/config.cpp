@@ -175,6 +175,20 @@ const char* CFG::tipName(void) {
 	return buildFullTipName(tip_name, tip_index);
 }
 
+// Build the complete name of the current IRON tip even if the Hot Air Gun is active
+const char* CFG::ironTipName(void) {
+	static char tip_name[tip_name_sz+5];
+	return buildFullTipName(tip_name, a_cfg.tip);
+}
+
+// The complete name of the tip that lost the usage statistics, the statistics area is full (see eeprom.h)
+const char* CFG::droppedStatsTipName(void) {
+	int16_t tip_index = EEPROM::droppedStats();
+	if (tip_index < 0) return 0;
+	static char tip_name[tip_name_sz+5];
+	return buildFullTipName(tip_name, tip_index);
+}
+
 // Save current configuration to the EEPROM
 void CFG::saveConfig(void) {
 	if (CFG_CORE::areConfigsIdentical())
@@ -313,6 +327,11 @@ int	CFG::tipList(uint8_t second, TIP_ITEM list[], uint8_t list_len, bool active_
 	return loaded;
 }
 
+uint8_t CFG::tipMask(uint8_t index) {
+	if (!tip_table || index == 0 || index >= TIPS::loaded()) return 0;	// Tip index 0 is the Hot Air Gun 'tip'
+	return tip_table[index].tip_mask;
+}
+
 // Initialize the configuration area. Save default configuration to the EEPROM
 void CFG::initConfigArea(void) {
 	clearConfigArea();
@@ -639,9 +658,24 @@ uint16_t TIP_CFG::tempCelsius(uint16_t temp, int16_t ambient, CFG_TEMP_DEVICE fo
 	} else {
 		if (temp <= tip[i].calibration[3]) {					// Inside calibration interval
 			for (uint8_t j = 1; j < 4; ++j) {
-				if (temp < tip[i].calibration[j]) {
-					tempH = map(temp, tip[i].calibration[j-1], tip[i].calibration[j],
-							referenceTemp(j-1, force_device)+d, referenceTemp(j, force_device)+d);
+				if (temp < tip[i].calibration[j] || j == 3) {	// The last point belongs to the last segment
+					if (tip[i].mask & TIP_CURVE) {				// Find the temperature on the fitted curve by bisection
+						int16_t lo = referenceTemp(j-1, force_device);
+						int16_t hi = referenceTemp(j, force_device);
+						while (hi - lo > 1) {
+							int16_t mid = (lo + hi) / 2;
+							if (curveTemp(i, mid, force_device) <= temp)
+								lo = mid;
+							else
+								hi = mid;
+						}
+						if (curveTemp(i, hi, force_device) - temp < temp - curveTemp(i, lo, force_device))
+							lo = hi;
+						tempH = lo + d;
+					} else {
+						tempH = map(temp, tip[i].calibration[j-1], tip[i].calibration[j],
+								referenceTemp(j-1, force_device)+d, referenceTemp(j, force_device)+d);
+					}
 					break;
 				}
 			}
@@ -654,6 +688,27 @@ uint16_t TIP_CFG::tempCelsius(uint16_t temp, int16_t ambient, CFG_TEMP_DEVICE fo
 	return tempH;
 }
 
+/*
+ * The internal temperature of the calibration curve at t Celsius: the Lagrange cubic through the four reference points.
+ * The polynomial of degree up to 3 fitted by MCALIB::calibrationOLS() is restored exactly from its four samples
+ */
+int32_t TIP_CFG::curveTemp(uint8_t i, int16_t t, CFG_TEMP_DEVICE force_device) {
+	int64_t summ = 0;
+	for (uint8_t k = 0; k < 4; ++k) {
+		int64_t num = tip[i].calibration[k] << 4;				// Q4 to round the sum
+		int64_t den = 1;
+		int16_t tk	= referenceTemp(k, force_device);
+		for (uint8_t m = 0; m < 4; ++m) {
+			if (m == k) continue;
+			int16_t tm = referenceTemp(m, force_device);
+			num *= t - tm;
+			den *= tk - tm;
+		}
+		summ += num / den;
+	}
+	return (summ + 8) >> 4;
+}
+
 // Return the reference temperature points of the IRON tip calibration
 void TIP_CFG::getTipCalibtarion(uint16_t temp[4]) {
 	uint8_t i = uint8_t(gun_active);
@@ -662,12 +717,12 @@ void TIP_CFG::getTipCalibtarion(uint16_t temp[4]) {
 }
 
 // Apply new IRON tip calibration data to the current configuration
-void TIP_CFG::applyTipCalibtarion(uint16_t temp[4], int8_t ambient) {
+void TIP_CFG::applyTipCalibtarion(uint16_t temp[4], int8_t ambient, bool curve) {
 	uint8_t i = uint8_t(gun_active);
 	for (uint8_t j = 0; j < 4; ++j)
 		tip[i].calibration[j]	= temp[j];
 	tip[i].ambient	= ambient;
-	tip[i].mask		= TIP_CALIBRATED | TIP_ACTIVE;
+	tip[i].mask		= TIP_CALIBRATED | TIP_ACTIVE | (curve?TIP_CURVE:0);
 	if (tip[i].calibration[3] > int_temp_max) tip[i].calibration[3] = int_temp_max;
 }
 
@@ -13,6 +13,8 @@
 #include "oled.h"
 #include "tools.h"
 #include "buzzer.h"
+#include "swtimer.h"
+#include "telemetry.h"
 
 #include "display.h"
 #include <math.h>
@@ -28,17 +30,30 @@ extern TIM_HandleTypeDef	htim2;
 extern TIM_HandleTypeDef	htim4;
 
 typedef enum { ADC_IDLE, ADC_CURRENT, ADC_TEMP } t_ADC_mode;
+// The main loop events posted by the interrupt handlers. The events are merged into the bit mask, see readEvents()
+typedef enum { EV_ENCODER = 1, EV_BUTTON = 2, EV_ADC = 4, EV_TICK = 8, EV_AC = 16, EV_SWITCH = 32, EV_ALL = 63 } t_EVENT;
+#define EV_QUEUE_SZ	(16)
 volatile static t_ADC_mode	adc_mode = ADC_IDLE;
 volatile static uint16_t	buff[ADC_BUFF_SZ];
 volatile static	uint32_t	tim1_cntr	= 0;				// Previous value of TIM1 counter. Using to check the TIM1 value changing
 volatile static	bool		ac_sine		= false;			// Flag indicating that TIM1 is driven by AC power interrupts on AC_ZERO pin
-volatile static uint8_t		check_count	= 1;				// Decrement from check_period to zero by TIM2. When become zero, force to check the IRON connectivity
 volatile static bool		clock_ok	= true;				// Flag indicating the system clock is working at 72 MHz (see RTC_IRQHandler()
+static uint16_t				boot_ms[BOOT_PHASES];			// Time (ms since reset) when the startup phases have been finished
+volatile static uint8_t		ev_queue[EV_QUEUE_SZ];			// The event queue filled by the interrupt handlers
+volatile static uint8_t		ev_head		= 0;				// The position to put new event to
+volatile static uint8_t		ev_tail		= 0;				// The position of the oldest event in the queue
+volatile static bool		ev_overflow	= false;			// Some events were lost, handle all of them
+volatile static uint16_t	loops_sec	= 0;				// The main loop iterations during last second (can be watched by the debugger)
+volatile static uint8_t		idle_pcnt	= 0;				// The CPU idle time during last second, percent (can be watched by the debugger)
+static uint32_t				idle_cycles	= 0;				// The CPU cycles spent in sleep mode since the statistics started
 const static uint16_t  		max_iron_pwm	= 1960;			// Max value should be less than TIM2.CHANNEL3 value by 20
 const static uint16_t  		max_gun_pwm		= 99;			// TIM1 period. Full power can be applied to the HOT GUN
-const static uint16_t		check_iron_pwm	= 1;			// This power should be applied to check the current through the IRON
-const static uint8_t		check_period	= 6;			// TIM2 loops between check current through the iron
+const static uint16_t		check_iron_pwm	= 1;			// This power is applied every TIM2 loop to check the current through the IRON
 const static	uint32_t	check_sw_period = 100;			// IRON switches check period, ms
+const static	uint32_t	tick_period		= 10;			// The main loop periodic event (EV_TICK) period, ms
+const static	uint32_t	ac_check_period	= 41;			// TIM1 counter check period, ms. 50Hz AC line generates 100Hz events
+const static	uint32_t	sync_timeout	= 50;			// Timeout to wait for two AC_ZERO events, ms
+const static	uint32_t	ready_timeout	= 1000;			// Maximum time to wait the hardware status updated at startup, ms
 
 static HW		core;										// Hardware core (including all device instances)
 
@@ -60,27 +75,88 @@ static	MENU_GUN		gun_menu(&core, &calib_manual, &tune, &pid_tune);
 static	MWORK_GUN		work_gun(&core);
 static  MABOUT			about(&core);
 static  MDEBUG			debug(&core);
+static	MFLREC			flight(&core);
 static	MMENU			main_menu(&core, &boost_setup, &calib_menu, &activate, &tune, &pid_tune, &gun_menu, &about);
 static	MODE*           pMode = &standby_iron;
 
 bool isACsine(void) 	{ return ac_sine; }
+uint16_t loopsPerSecond(void)	{ return loops_sec; }
+uint8_t	idlePercent(void)		{ return idle_pcnt; }
+
+// Put the event into the queue, called by interrupt handlers
+static void postEvent(t_EVENT ev) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint8_t next = (ev_head + 1) % EV_QUEUE_SZ;
+	if (next == ev_tail) {									// The queue is full
+		ev_overflow	= true;
+	} else {
+		ev_queue[ev_head] = ev;
+		ev_head	= next;
+	}
+	__set_PRIMASK(primask);
+}
+
+// Read all the events from the queue, return the bit mask of the events
+static uint8_t readEvents(void) {
+	uint8_t events = 0;
+	__disable_irq();
+	while (ev_tail != ev_head) {
+		events |= ev_queue[ev_tail];
+		ev_tail = (ev_tail + 1) % EV_QUEUE_SZ;
+	}
+	if (ev_overflow) {
+		events		= EV_ALL;
+		ev_overflow	= false;
+	}
+	__enable_irq();
+	return events;
+}
+
+/*
+ * Sleep till the next interrupt if there is no event in the queue.
+ * The interrupts are disabled while checking the queue, WFI wakes up the CPU by pending interrupt anyway,
+ * so the event posted right after the check would not be missed
+ */
+static void waitEvent(void) {
+	__disable_irq();
+	if (ev_tail == ev_head && !ev_overflow) {
+		uint32_t start = cycleCounter();
+		__WFI();
+		idle_cycles += cycleCounter() - start;
+	}
+	__enable_irq();
+}
+
+uint16_t bootPhaseTime(BOOT_PHASE phase) {
+	if (phase >= BOOT_PHASES) return 0;
+	return boot_ms[phase];
+}
+
+static void bootPhase(BOOT_PHASE phase) {
+	boot_ms[phase] = HAL_GetTick();
+}
 
 // Synchronize TIM2 timer to AC power
 uint16_t syncAC(void) {
-	uint32_t to = HAL_GetTick() + 300;						// The timeout
+	uint32_t start = HAL_GetTick();							// Compare the elapsed time with the timeout, it is safe when the tick counter wraps
 	uint16_t nxt_tim1	= TIM1->CNT + 2;
 	if (nxt_tim1 > 99) nxt_tim1 -= 99;						// TIM1 is clocked by AC zero crossing signal, period is 99.
-	while (HAL_GetTick() < to) {							// Prevent hang
+	bool synced = false;
+	while (HAL_GetTick() - start < sync_timeout) {			// Prevent hang
 		if (TIM1->CNT == nxt_tim1) {
 			TIM2->CNT = 0;									// Synchronize TIM2 to AC power zero crossing signal
+			synced = true;
 			break;
 		}
 	}
+	if (!synced)											// No AC_ZERO events, do not wait again
+		return TIM2->ARR+1;
 	// Checking the TIM2 has been synchronized
-	to = HAL_GetTick() + 300;
+	start = HAL_GetTick();
 	nxt_tim1 = TIM1->CNT + 2;
 	if (nxt_tim1 > 99) nxt_tim1 -= 99;
-	while (HAL_GetTick() < to) {
+	while (HAL_GetTick() - start < sync_timeout) {
 		if (TIM1->CNT == nxt_tim1) {
 			return TIM2->CNT;
 		}
@@ -90,36 +166,63 @@ uint16_t syncAC(void) {
 
 void SCRSAVER::reset(void) {
 	if (to > 0) {
-		scr_save_ms = HAL_GetTick() + (uint32_t)to * 60000;
+		scr_timer.start((uint32_t)to * 60000);
 	} else {
-		scr_save_ms = 0;								// Disable screen saver
+		scr_timer.cancel();								// Disable screen saver
 	}
 	scr_saver = false;
 }
 
 bool SCRSAVER::scrSaver(void) {
-    if (scr_save_ms && !scr_saver && HAL_GetTick() >= scr_save_ms) {
+    if (scr_timer.expired()) {
     	scr_saver = true;
     }
     return scr_saver;
 }
 
+bool RENDER::due(uint16_t period) {
+	uint32_t elapsed = HAL_GetTick() - last_frame;
+	if (!redraw && elapsed < period)	return false;
+	if (elapsed < min_interval)			return false;		// Merge the requests coming too often
+	if (adcWindow())					return false;		// Postpone the frame till the ADC conversion
+	redraw		= false;
+	last_frame	= HAL_GetTick();
+	return true;
+}
+
+// TIM2 starts the ADC conversion when the counter reaches CCR3 (current) or CCR4 (temperature) value
+bool RENDER::adcWindow(void) {
+	uint16_t cnt	= TIM2->CNT;
+	uint16_t top	= TIM2->ARR + 1;
+	uint16_t to_ch3	= (TIM2->CCR3 + top - cnt) % top;		// TIM2 ticks till the channel 3 event
+	uint16_t to_ch4	= (TIM2->CCR4 + top - cnt) % top;
+	return (to_ch3 < adc_guard || to_ch4 < adc_guard);
+}
+
 CFG_STATUS HW::init(void) {
 	dspl.init();
+	bootPhase(BOOT_DISPLAY);
 	iron.init();
 	hotgun.init();
 	encoder.addButton(ENCODER_B_GPIO_Port, ENCODER_B_Pin);
 	CFG_STATUS cfg_init = 	cfg.init();
+	bootPhase(BOOT_CONFIG);
 	PIDparam pp   		= 	cfg.pidParams(true);			// load IRON PID parameters
 	iron.load(pp);
 	pp					=	cfg.pidParams(false);			// load Hot Air Gun PID parameters
 	hotgun.load(pp);
 	buzz.activate(cfg.isBuzzerEnabled());
 	scrsaver.init(cfg.getScrTo());							// Screen saver timeout can be reloaded via main menu, see MMENU::loop()
+	usage.init(&cfg);
 	return cfg_init;
 }
 
 extern "C" void setup(void) {
+	cycleCounterInit();										// Used to profile the code
+#ifdef DEBUG												// Defined by the Debug build configuration only
+	HAL_DBGMCU_EnableDBGSleepMode();						// Keep the debugger connected while the CPU sleeps in the main loop
+#endif
+	bootPhase(BOOT_START);
 	CFG_STATUS cfg_init = core.init();						// Initialize the hardware structure before start timers
 
 	HAL_ADCEx_Calibration_Start(&hadc1);					// Calibrate both ADCs
@@ -131,6 +234,7 @@ extern "C" void setup(void) {
 	HAL_TIM_OC_Start_IT(&htim2,  TIM_CHANNEL_3);			// Check the current through the IRON and FAN, also check ambient temperature
 	HAL_TIM_OC_Start_IT(&htim2,  TIM_CHANNEL_4);			// Calculate power of the IRON
 	HAL_TIM_PWM_Start(&htim4,    TIM_CHANNEL_4);			// PWM signal for the buzzer
+	bootPhase(BOOT_TIMERS);
 
 	// Setup main mode parameters: return mode, short press mode, long press mode
 	standby_iron.setup(&select, &work_iron, &main_menu);
@@ -143,13 +247,14 @@ extern "C" void setup(void) {
 	calib_manual.setup(&calib_menu, &standby_iron, &standby_iron);
 	calib_menu.setup(&standby_iron, &standby_iron, &standby_iron);
 	tune.setup(&standby_iron, &standby_iron, &standby_iron);
-	fail.setup(&standby_iron, &standby_iron, &standby_iron);
+	fail.setup(&standby_iron, &standby_iron, &flight);
 	boost_setup.setup(&main_menu, &main_menu, &standby_iron);
 	pid_tune.setup(&standby_iron, &standby_iron, &standby_iron);
 	gun_menu.setup(&main_menu, &standby_iron, &standby_iron);
 	main_menu.setup(&standby_iron, &standby_iron, &standby_iron);
 	about.setup(&standby_iron, &standby_iron, &debug);
-	debug.setup(&standby_iron, &standby_iron, &standby_iron);
+	debug.setup(&standby_iron, &standby_iron, &flight);
+	flight.setup(&standby_iron, &standby_iron, &standby_iron);
 
 	standby_iron.setGunMode(&work_gun);
 	work_iron.setGunMode(&work_gun);
@@ -170,24 +275,55 @@ extern "C" void setup(void) {
 			break;
 	}
 
-	syncAC();												// Synchronize TIM2 timer to AC power
-	HAL_Delay(1000);										// Wait till hardware status updated
+	ac_sine = (syncAC() <= TIM2->ARR);						// Synchronize TIM2 timer to AC power
+	bootPhase(BOOT_AC_SYNC);
+
+	// Wait till hardware status updated: the IRON connectivity checked and ambient temperature averaged
+	uint32_t start = HAL_GetTick();
+	while (HAL_GetTick() - start < ready_timeout) {
+		if (core.iron.isCurrentSettled() && core.iron.isAmbientSettled())
+			break;
+	}
+	bootPhase(BOOT_READY);
 	pMode->init();
 }
 
 
+/*
+ * The main loop is driven by the events posted by the interrupt handlers:
+ * encoder rotated, button status changed, ADC conversion complete and periodic events from SysTick.
+ * The working mode loop runs once for all events read from the queue. When there is no event, the CPU sleeps
+ */
 extern "C" void loop(void) {
-	static uint32_t AC_check_time	= 0;					// Time in ms when to check TIM1 is running
-	static uint32_t	check_sw		= 0;					// Time when check iron switches status (ms)
+	static uint16_t	loops			= 0;					// The main loop iterations since the statistics started
+	static uint32_t	stat_ms			= 0;					// The time when the statistics started, ms
+	static uint32_t	stat_cycles		= 0;					// The CPU cycle counter value when the statistics started
+
+	uint8_t events = readEvents();
+	if (events == 0) {
+		waitEvent();
+		return;
+	}
+	++loops;
 
-	if (HAL_GetTick() > check_sw) {
-		check_sw = HAL_GetTick() + check_sw_period;
+	if (events & EV_SWITCH) {
 		GPIO_PinState pin = HAL_GPIO_ReadPin(TILT_SW_GPIO_Port, TILT_SW_Pin);
 		core.iron.updateReedStatus(GPIO_PIN_SET == pin);		// Update T12 TILT switch status
 		pin = HAL_GPIO_ReadPin(GUN_REED_GPIO_Port, GUN_REED_Pin);
 		core.hotgun.updateReedStatus(GPIO_PIN_SET == pin);	// Switch active when the Hot Air Gun handle is off-hook
 	}
 
+	// If TIM1 counter has been changed since last check, we received AC_ZERO events from AC power
+	bool power_lost = false;
+	if (events & EV_AC) {
+		bool ac_was	= ac_sine;
+		ac_sine		= (TIM1->CNT != tim1_cntr);
+		tim1_cntr	= TIM1->CNT;
+		power_lost	= ac_was && !ac_sine;
+	}
+	if (power_lost)
+		core.usage.update(&core.cfg, true);					// Save the usage statistics while the capacitors still keep the power
+
 	MODE* new_mode = pMode->returnToMain();
 	if (new_mode && new_mode != pMode) {
 		core.buzz.doubleBeep();
@@ -207,14 +343,36 @@ extern "C" void loop(void) {
 		pMode->init();
 	}
 
-	// If TIM1 counter has been changed since last check, we received AC_ZERO events from AC power
-	if (HAL_GetTick() >= AC_check_time) {
-		ac_sine		= (TIM1->CNT != tim1_cntr);
-		tim1_cntr	= TIM1->CNT;
-		AC_check_time = HAL_GetTick() + 41;					// 50Hz AC line generates 100Hz events. The pulse period is 10 ms
+	if (events & EV_TICK) {
+		core.usage.update(&core.cfg, false);				// Save the usage statistics if they changed enough
+		core.cfg.writeBack();								// Save modified EEPROM data from the RAM mirror
+		if (HAL_GetTick() - stat_ms >= 1000) {				// Update the main loop statistics every second
+			uint32_t now	= cycleCounter();
+			uint32_t total	= (now - stat_cycles) / 100;
+			if (total > 0)
+				idle_pcnt	= constrain(idle_cycles / total, 0, 100);
+			loops_sec		= loops;
+			loops			= 0;
+			idle_cycles		= 0;
+			stat_cycles		= now;
+			stat_ms			= HAL_GetTick();
+		}
 	}
 }
 
+/*
+ * SysTick hook, called every ms from SysTick_Handler()
+ * Post the periodic events to the main loop and sample the encoder button
+ */
+extern "C" void coreTick(void) {
+	swTimerTick();
+	uint32_t now = HAL_GetTick();
+	if (now % tick_period == 0)		postEvent(EV_TICK);
+	if (now % check_sw_period == 0)	postEvent(EV_SWITCH);
+	if (now % ac_check_period == 0)	postEvent(EV_AC);
+	if (core.encoder.buttonTick(now))	postEvent(EV_BUTTON);
+}
+
 static bool adcStart(t_ADC_mode mode) {
     if (adc_mode != ADC_IDLE) {								// Not ready to check analog data; Something is wrong!!!
     	TIM2->CCR1 = 0;										// Switch off the IRON
@@ -249,6 +407,50 @@ extern "C" void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim) {
 	}
 }
 
+// Put the control cycle data to the telemetry stream
+static void sendTelemetry(uint16_t iron_raw, uint16_t ambient) {
+	TLM_RECORD	rec;
+	int32_t		p, i, d;
+	core.iron.pidTerms(p, i, d);
+	rec.mode		= core.iron.powerMode() | (core.hotgun.powerMode() << 4);
+	rec.time		= HAL_GetTick();
+	rec.iron_raw	= iron_raw;
+	rec.iron_temp	= core.iron.averageTemp();
+	rec.iron_set	= core.iron.presetTemp();
+	rec.iron_pwm	= TIM2->CCR1;
+	rec.pid_p		= p;
+	rec.pid_i		= i;
+	rec.pid_d		= d;
+	rec.gun_temp	= core.hotgun.averageTemp();
+	rec.gun_set		= core.hotgun.presetTemp();
+	rec.gun_pwm		= TIM1->CCR4;
+	rec.fan_pwm		= TIM2->CCR2;
+	rec.ambient		= ambient;
+	tlmSend(&rec);
+}
+
+// Save the control cycle into the flight recorder, freeze it when the IRON or the Hot Air Gun overheats
+static void recordCycle(void) {
+	static bool		overheat = false;
+	FLREC_ENTRY		e;
+	e.iron_temp		= core.iron.temp();
+	e.iron_pwm		= TIM2->CCR1;
+	e.gun_temp		= core.hotgun.averageTemp();
+	e.gun_pwm		= TIM1->CCR4;
+	e.fan_pwm		= TIM2->CCR2;
+	e.mode			= core.iron.powerMode() | (core.hotgun.powerMode() << 4);
+	e.flags			= 0;
+	if (core.iron.isConnected())	e.flags |= FLR_IRON_CONN;
+	if (core.hotgun.isConnected())	e.flags |= FLR_GUN_CONN;
+	if (core.iron.isOverheat())		e.flags |= FLR_IRON_HOT;
+	if (core.hotgun.isOverheat())	e.flags |= FLR_GUN_HOT;
+	core.recorder.add(e);
+	bool hot = e.flags & (FLR_IRON_HOT | FLR_GUN_HOT);
+	if (hot && !overheat)
+		core.recorder.freeze();
+	overheat = hot;
+}
+
 /*
  * IRQ handler of ADC complete request. The data is in the ADC buffer (buff)
  * Data read by 8 slots interleaved: adc1-rank1, adc2-rank1, adc1-rank2, adc2-rank2, ..., adc1-rank4, adc2-rank4
@@ -280,19 +482,22 @@ extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
 		ambient  	/= ADC_LOOPS;
 		core.iron.updateAmbient(ambient);
 
-		uint8_t min_iron_pwm = 0;							// By default do not power the IRON to check connectivity
-		if (--check_count == 0) {							// It is time to check IRON is connected or not
-			check_count	= check_period;
-			min_iron_pwm = check_iron_pwm;
-		}
+		// The short probe pulse every TIM2 loop lets the current check detect the IRON connected or disconnected in two loops
 		if (core.iron.isConnected()) {
 			uint16_t iron_power = core.iron.power(iron_temp);
-			TIM2->CCR1	= constrain(iron_power, min_iron_pwm, max_iron_pwm);
+			TIM2->CCR1	= constrain(iron_power, check_iron_pwm, max_iron_pwm);
 
 		} else {
-			TIM2->CCR1	= min_iron_pwm;						// Sometimes supply minimum power to the IRON to check connectivity
+			TIM2->CCR1	= check_iron_pwm;					// Supply minimum power to the IRON to check connectivity
 		}
 		core.hotgun.updateTemp(gun_temp);					// Update average Hot Air Gun temperature. Apply the power by TIM1.CNANNEL3 interrupt
+		sendTelemetry(iron_temp, ambient);
+		recordCycle();
+		IRON::PowerMode		i_mode = core.iron.powerMode();
+		HOTGUN::PowerMode	g_mode = core.hotgun.powerMode();
+		core.usage.cycle(i_mode == IRON::POWER_ON || i_mode == IRON::POWER_FIXED, TIM2->CCR1,
+				g_mode == HOTGUN::POWER_ON || g_mode == HOTGUN::POWER_FIXED || g_mode == HOTGUN::POWER_HEATING);
+		postEvent(EV_ADC);
 	} else if (adc_mode == ADC_CURRENT) {					// Read the currents, the temperatures should be ignored
 		volatile uint32_t iron_curr	= 0;
 		volatile uint32_t fan_curr 	= 0;
@@ -316,9 +521,17 @@ extern "C" void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
 extern "C" void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc) 				{ }
 extern "C" void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc) 	{ }
 
-// Encoder Rotated
+// Encoder Rotated, channel A changed
 extern "C" void EXTI0_IRQHandler(void) {
 	core.encoder.encoderIntr();
 	__HAL_GPIO_EXTI_CLEAR_IT(ENCODER_L_Pin);
+	postEvent(EV_ENCODER);
+}
+
+// Encoder Rotated, channel B changed
+extern "C" void EXTI9_5_IRQHandler(void) {
+	core.encoder.encoderIntr();
+	__HAL_GPIO_EXTI_CLEAR_IT(ENCODER_R_Pin);
+	postEvent(EV_ENCODER);
 }
 
@@ -6,7 +6,6 @@
 #include "display.h"
 #include "tools.h"
 #include <string.h>
-#include <stdio.h>
 
 /*
  * Bitmaps
@@ -164,9 +163,9 @@ static const uint8_t bmFan[4][32] = {
 };
 
 static const char* k_proto[3] = {
-	"Kp = %5d",
-	"Ki = %5d",
-	"Kd = %5d"
+	"Kp = ",
+	"Ki = ",
+	"Kd = "
 };
 
 void DSPL::init(void)  {
@@ -181,6 +180,188 @@ void DSPL::init(void)  {
 	saver_center[0] = d_width/2;
 	saver_center[1] = d_height/2;
 	begin();
+	buildDigitCache();
+	full_frame		= true;
+}
+
+/*
+ * Copy the frame into the transfer buffer and send it by DMA, see oled.cpp
+ * The next frame can be drawn in the u8g2 buffer while the previous one is being transferred
+ * The transfer buffer keeps the display content, so only the modified tiles (8x8 pixels) are sent:
+ * in every tile row the area from the first to the last changed tile
+ */
+void DSPL::sendBuffer(void) {
+	oledWait();												// The previous frame should be sent completely
+	if (oledAborted())										// Some tiles of tx_frame were not sent, the display content is unknown
+		full_frame = true;
+	view_id	= VIEW_NONE;									// The screen data is unknown, see viewSave()
+	uint8_t *frame	= u8g2.tile_buf_ptr;
+	uint8_t	tiles	= d_width / 8;							// Number of tiles in the tile row
+	u8g2.tile_buf_ptr = tx_frame;							// Record the transfers from the transfer buffer
+	oledTransferBegin();
+	for (uint8_t ty = 0; ty < d_height / 8; ++ty) {
+		uint8_t *row	= &frame[ty * d_width];
+		uint8_t *tx_row	= &tx_frame[ty * d_width];
+		int8_t first = -1, last = -1;
+		for (uint8_t tx = 0; tx < tiles; ++tx) {
+			if (full_frame || memcmp(&row[tx*8], &tx_row[tx*8], 8) != 0) {
+				if (first < 0) first = tx;
+				last = tx;
+			}
+		}
+		if (first >= 0) {
+			uint8_t tw = last - first + 1;
+			memcpy(&tx_row[first*8], &row[first*8], tw*8);
+			U8G2::updateDisplayArea(first, ty, tw, 1);
+		}
+	}
+	oledTransferCommit();
+	u8g2.tile_buf_ptr = frame;
+	full_frame = false;
+}
+
+// Check the screen data differs from the displayed one, so the screen should be redrawn
+bool DSPL::viewChanged(DSPL_VIEW id, const void *view, uint8_t size) {
+	if (full_frame || view_id != id || size > sizeof(view_data)) return true;
+	return memcmp(view_data, view, size) != 0;
+}
+
+// Save the data of the screen just sent to the display
+void DSPL::viewSave(DSPL_VIEW id, const void *view, uint8_t size) {
+	if (size > sizeof(view_data)) return;
+	memcpy(view_data, view, size);
+	view_id = id;
+}
+
+/*
+ * Read the pixel of the glyph column from the frame buffer in display memory order (vertical bytes)
+ * lx - logical column, base - logical base line, i - the row number counting from the top of glyph window (32 rows)
+ */
+static bool glyphPixel(const uint8_t *buff, bool r2, int16_t lx, int16_t base, uint8_t i) {
+	int16_t hx = r2?(d_width-1-lx):lx;
+	int16_t hy = r2?(d_height-1-base+i):(base-31+i);
+	return buff[(hy >> 3)*d_width + hx] & (1 << (hy & 7));
+}
+
+// Count the pixels of the frame buffer having the value
+static uint16_t framePixels(const uint8_t *buff, bool value) {
+	uint16_t count = 0;
+	for (uint16_t i = 0; i < d_width*d_height/8; ++i) {
+		uint8_t b = value?buff[i]:~buff[i];
+		for ( ; b; b &= b-1) ++count;
+	}
+	return count;
+}
+
+/*
+ * Decode the large digits of u8g2_font_kam28n font once, the run-length font decoder is rather slow.
+ * Every digit is drawn into the empty frame buffer to get the glyph pixels and into the filled one
+ * to get the glyph box (in solid font mode the decoder clears the background inside the box).
+ * The glyph columns are saved in display memory order to be copied directly to the frame buffer.
+ * The cache is not used if the glyph is out of the scanned window or the display is rotated by 90 degrees
+ */
+void DSPL::buildDigitCache(void) {
+	const int16_t	pen_x	= 8;							// The pen position of the glyph
+	const int16_t	pen_y	= 40;							// The glyph base line
+	const int16_t	win_x	= pen_x - 2;					// The scanned window left column
+	const uint8_t	win_w	= digit_cache_w + 4;			// The scanned window width, the window height is 32 rows
+	uint32_t		ink[win_w], box[win_w];
+
+	digit_cache_ok	= false;
+	bool r2 = (u8g2.cb == U8G2_R2);
+	if (!r2 && u8g2.cb != U8G2_R0) return;
+	uint8_t *buff	= U8G2::getBufferPtr();
+	U8G2::setFont(u8g2_font_kam28n);
+	U8G2::setDrawColor(1);
+	for (uint8_t d = 0; d < 10; ++d) {
+		DIGIT_GLYPH	*g	= &digit_cache[d];
+		uint16_t	ink_count	= 0;
+		uint16_t	bg_count	= 0;
+		memset(buff, 0, d_width*d_height/8);
+		g->advance = U8G2::drawGlyph(pen_x, pen_y, '0'+d);
+		for (uint8_t c = 0; c < win_w; ++c) {
+			ink[c] = 0;
+			for (uint8_t i = 0; i < 32; ++i) {
+				if (glyphPixel(buff, r2, win_x+c, pen_y, i)) {
+					ink[c] |= (uint32_t)1 << i;
+					++ink_count;
+				}
+			}
+		}
+		if (ink_count != framePixels(buff, true)) break;	// The glyph is out of the window
+		memset(buff, 0xff, d_width*d_height/8);
+		U8G2::drawGlyph(pen_x, pen_y, '0'+d);
+		for (uint8_t c = 0; c < win_w; ++c) {
+			box[c] = ink[c];
+			for (uint8_t i = 0; i < 32; ++i) {
+				if (!glyphPixel(buff, r2, win_x+c, pen_y, i)) {
+					box[c] |= (uint32_t)1 << i;
+					++bg_count;
+				}
+			}
+		}
+		if (bg_count != framePixels(buff, false)) break;
+		int8_t first = -1, last = -1;
+		g->box = 0;
+		for (uint8_t c = 0; c < win_w; ++c) {
+			if (box[c]) {
+				if (first < 0) first = c;
+				last = c;
+				g->box |= box[c];
+			}
+		}
+		if (first < 0) first = last = 0;				// Empty glyph
+		g->x		= win_x - pen_x + first;
+		g->width	= last - first + 1;
+		if (g->width > digit_cache_w) break;
+		for (uint8_t c = 0; c < g->width; ++c)
+			g->ink[c] = ink[first+c];
+		if (d == 9) digit_cache_ok = true;
+	}
+	U8G2::clearBuffer();
+}
+
+// Draw the string by the current font using the cached digits if possible, see u8g2_DrawStr()
+void DSPL::drawDigits(int16_t x, int16_t y, const char *str) {
+	bool cached = digit_cache_ok && u8g2.font == u8g2_font_kam28n && u8g2.draw_color == 1;
+	for ( ; *str; ++str) {
+		char c = *str;
+		if (cached && c >= '0' && c <= '9') {
+			const DIGIT_GLYPH *g = &digit_cache[c - '0'];
+			drawCachedDigit(x, y, g);
+			x += g->advance;
+		} else {
+			x += U8G2::drawGlyph(x, y, c);
+		}
+	}
+}
+
+// Copy the cached glyph into the frame buffer: clear the glyph box (solid font mode) and set the glyph pixels
+void DSPL::drawCachedDigit(int16_t x, int16_t y, const DIGIT_GLYPH *g) {
+	bool	r2		= (u8g2.cb == U8G2_R2);
+	int16_t	top		= r2?(d_height-1-y):(y-31);			// The display memory row of the glyph window top
+	if (top <= -32 || top >= d_height) return;
+	bool	solid	= (u8g2.font_decode.is_transparent == 0);
+	uint8_t	*buff	= U8G2::getBufferPtr();
+	x += g->x;
+	for (uint8_t c = 0; c < g->width; ++c, ++x) {
+		if (x < 0 || x >= d_width) continue;
+		uint64_t ink	= g->ink[c];
+		uint64_t box	= solid?g->box:g->ink[c];
+		if (top >= 0) {
+			ink <<= top;
+			box <<= top;
+		} else {
+			ink >>= -top;
+			box >>= -top;
+		}
+		uint8_t *col	= &buff[r2?(d_width-1-x):x];
+		for (uint8_t page = 0; page < d_height/8; ++page) {
+			uint8_t	mask = box >> (page*8);
+			if (mask)
+				col[page*d_width] = (col[page*d_width] & ~mask) | (uint8_t)(ink >> (page*8));
+		}
+	}
 }
 
 void DSPL::status(const char *msg) {
@@ -228,7 +409,7 @@ void DSPL::msgBoost(void) {
 }
 
 void DSPL::timeToOff(uint8_t time) {
-	sprintf(msg_buff, "%2d", time);
+	fmtInt(msg_buff, time, 2);
 }
 
 void DSPL::tip(const char *tip_name) {
@@ -237,13 +418,14 @@ void DSPL::tip(const char *tip_name) {
 }
 
 void DSPL::fanSpeed(uint8_t pcnt) {
-	sprintf(tip_name, "Fan:%3d%c", pcnt, '%');
+	char *p = fmtInt(fmtStr(tip_name, "Fan:"), pcnt, 3);
+	fmtStr(p, "%");
 }
 
 void DSPL::animateFan(uint8_t indx) {
 	indx &= 0x3;													// Can be from 0 to 3
 	U8G2::drawBitmap(0, d_height/2-8, 2, 16, bmFan[indx]);
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 /*
@@ -264,10 +446,14 @@ void DSPL::mainShow(uint16_t t_set, uint16_t t_cur, int16_t t_amb, uint8_t p_app
 	t_set		= constrain(t_set, 0, 999);
 	t_cur		= constrain(t_cur, 0, 999);
 	p_applied	= constrain(p_applied, 0, 100);
-	static char sym[] = {'C', '\0'};
-	if (is_celsius) sym[0] = 'C'; else sym[0] = 'F';
 	char buff[10];
 
+	// Do not follow the temperature changes by one degree to prevent the display flickering
+	int16_t t_diff = (int16_t)t_cur - (int16_t)t_shown;
+	if (t_diff > t_hysteresis || t_diff < -t_hysteresis)
+		t_shown = t_cur;
+	t_cur		= t_shown;
+
 	uint8_t preset_label = d_width - d_width / 4 - 10;
 	uint8_t temp_bar = 0;
 	if (t_cur > t_amb && (t_cur - t_amb) > 20) {
@@ -277,23 +463,35 @@ void DSPL::mainShow(uint16_t t_set, uint16_t t_cur, int16_t t_amb, uint8_t p_app
 
 	uint8_t p_height = gauge(p_applied, 10, 30);					// Applied power triangle height
 
-	U8G2::clearBuffer();
+	MAIN_VIEW view;
+	memset(&view, 0, sizeof(view));
+	view.t_set		= t_set;
+	view.t_cur		= t_cur;
+	view.t_alter	= t_alter;
+	view.t_amb		= (t_alter > 0)?0:t_amb;					// The ambient temperature is not shown with the alternate one
+	view.temp_bar	= temp_bar;
+	view.p_height	= p_height;
+	view.fan_index	= fan_index;
+	view.tilt		= tilt_iron_used;
+	view.celsius	= is_celsius;
+	view.calibrated	= tip_calibrated;
+	strcpy(view.msg, msg_buff);
+	strcpy(view.tip, tip_name);
+	if (!viewChanged(VIEW_MAIN, &view, sizeof(view))) return;	// The displayed data is actual
+
+	uint32_t start = cycleCounter();
+	if (!bg_valid || bg_celsius != is_celsius || bg_calibrated != tip_calibrated || strcmp(bg_tip, tip_name) != 0)
+		mainBackground(is_celsius, tip_calibrated);
+	memcpy(U8G2::getBufferPtr(), bg_frame, sizeof(bg_frame));	// Start with the static layer
 	U8G2::setFont(u8g_font_profont15r);
 	// Show preset temperature
-	sprintf(buff, "%3d", t_set);
-	U8G2::drawBitmap(0, 1, 1, 15, bmTemperature);
+	fmtInt(buff, t_set, 3);
 	uint8_t width = U8G2::getStrWidth(buff);
 	U8G2::drawStr(15, 12, buff);
-	U8G2::drawBitmap(16+width, 1, 1, 5, bmDegree);
-	U8G2::drawStr(24+width, 12, sym);
 
 	// Show status message: 'ON', 'OFF', 'Idle', etc.
 	width = U8G2::getStrWidth(msg_buff);
 	U8G2::drawStr(d_width-5 - width, 12, msg_buff);
-	// Show tip name
-	U8G2::drawStr(12, d_height, tip_name);
-	if (!tip_calibrated)
-		U8G2::drawBitmap(0, d_height-9, 1, 9, bmNotCalibrated);
 
 	// Show the applied power
 	if (p_height > 0)
@@ -301,32 +499,24 @@ void DSPL::mainShow(uint16_t t_set, uint16_t t_cur, int16_t t_amb, uint8_t p_app
 
 
 	if (t_alter > 0) {											// Show alternate device temperature
-		sprintf(buff, "%3d", t_alter);
+		fmtInt(buff, t_alter, 3);
 		width = U8G2::getStrWidth(buff);
 		U8G2::drawStr(d_width-width-20, d_height, buff);
 		U8G2::drawDisc(d_width-width-28, d_height-5, 2);
 	} else {
 		// Show the ambient temperature
 		if (t_amb >= -9 && t_amb < 100) {
-			sprintf(buff, "%2d", t_amb);
+			fmtInt(buff, t_amb, 2);
 			width = U8G2::getStrWidth(buff);
 			U8G2::drawStr(d_width-20-width, d_height, buff);
 		}
 	}
-	// Show degree symbol and units ('C' or 'F')
-	U8G2::drawBitmap(d_width-20, d_height-12, 1, 5, bmDegree);
-	U8G2::drawStr(d_width-12, d_height, sym);
-
-
 	// Show the current IRON or Hot Air Gun temperature
-	sprintf(buff, "%3d", t_cur);
+	fmtInt(buff, t_cur, 3);
 	U8G2::setFont(u8g2_font_kam28n);
 	width = U8G2::getStrWidth(buff);
-	U8G2::drawStr((d_width-width+1)/2, 42, buff);
+	drawDigits((d_width-width+1)/2, 42, buff);
 
-	// Show temperature bar greed
-	U8G2::drawHLine(5, 51, d_width-10);
-	U8G2::drawVLine(5+preset_label, 47, 6);
 	// Show the temperature bar
 	if (temp_bar > 3) {
 		U8G2::drawBox(5, 48, temp_bar, 3);
@@ -341,7 +531,41 @@ void DSPL::mainShow(uint16_t t_set, uint16_t t_cur, int16_t t_amb, uint8_t p_app
 		fan_index &= 0x3;										// Can be from 0 to 3
 		U8G2::drawBitmap(0, d_height/2-8, 2, 16, bmFan[fan_index]);
 	}
-	U8G2::sendBuffer();
+	render_us = cyclesToUs(cycleCounter() - start);
+	sendBuffer();
+	viewSave(VIEW_MAIN, &view, sizeof(view));
+}
+
+/*
+ * Draw the static part of the main screen: thermometer, degree symbols, units, tip name and temperature bar grid
+ * and save it to the bg_frame buffer. The static layer is rebuilt when the data changed or by mainInit()
+ */
+void DSPL::mainBackground(bool is_celsius, bool tip_calibrated) {
+	const char *sym = is_celsius?"C":"F";
+	uint8_t preset_label = d_width - d_width / 4 - 10;
+
+	U8G2::clearBuffer();
+	U8G2::setFont(u8g_font_profont15r);
+	U8G2::drawBitmap(0, 1, 1, 15, bmTemperature);
+	uint8_t width = U8G2::getStrWidth("000");					// The font is monospace, the preset temperature width is fixed
+	U8G2::drawBitmap(16+width, 1, 1, 5, bmDegree);
+	U8G2::drawStr(24+width, 12, sym);
+	// Show tip name
+	U8G2::drawStr(12, d_height, tip_name);
+	if (!tip_calibrated)
+		U8G2::drawBitmap(0, d_height-9, 1, 9, bmNotCalibrated);
+	// Show degree symbol and units ('C' or 'F')
+	U8G2::drawBitmap(d_width-20, d_height-12, 1, 5, bmDegree);
+	U8G2::drawStr(d_width-12, d_height, sym);
+	// Show temperature bar greed
+	U8G2::drawHLine(5, 51, d_width-10);
+	U8G2::drawVLine(5+preset_label, 47, 6);
+
+	memcpy(bg_frame, U8G2::getBufferPtr(), sizeof(bg_frame));
+	strcpy(bg_tip, tip_name);
+	bg_celsius		= is_celsius;
+	bg_calibrated	= tip_calibrated;
+	bg_valid		= true;
 }
 
 void DSPL::scrSave(SCR_MODE mode, uint16_t t_cur, uint16_t t_alter) {
@@ -355,22 +579,22 @@ void DSPL::scrSave(SCR_MODE mode, uint16_t t_cur, uint16_t t_alter) {
 		height += 16;
 		width = U8G2::getStrWidth(modes[(uint8_t)mode]);
 		U8G2::drawStr(saver_center[0]-width/2, saver_center[1]-height/2+15, modes[(uint8_t)mode]);
-		sprintf(buff, "%3d", t_alter);
+		fmtInt(buff, t_alter, 3);
 		width = U8G2::getStrWidth(buff);
 		U8G2::drawStr(saver_center[0]-width/2, saver_center[1]+height/2, buff);
 		U8G2::setFont(u8g2_font_kam28n);
-		sprintf(buff, "%3d", t_cur);
+		fmtInt(buff, t_cur, 3);
 		width   = U8G2::getStrWidth(buff);
-		U8G2::drawStr(saver_center[0]-width/2, saver_center[1]+15, buff);
+		drawDigits(saver_center[0]-width/2, saver_center[1]+15, buff);
 	} else {
 		width = U8G2::getStrWidth(modes[(uint8_t)mode]);
 		U8G2::drawStr(saver_center[0]-width/2, saver_center[1]-height/2+13, modes[(uint8_t)mode]);
 		U8G2::setFont(u8g2_font_kam28n);
-		sprintf(buff, "%3d", t_cur);
+		fmtInt(buff, t_cur, 3);
 		width   = U8G2::getStrWidth(buff);
-		U8G2::drawStr(saver_center[0]-width/2, saver_center[1]+height/2, buff);
+		drawDigits(saver_center[0]-width/2, saver_center[1]+height/2, buff);
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 
 	// calculate new message position
 	if (saver_speed[0] > 0) {
@@ -398,10 +622,10 @@ void DSPL::scrSave(SCR_MODE mode, uint16_t t_cur, uint16_t t_alter) {
 void  DSPL::tuneShow(uint16_t tune_temp, uint16_t temp, uint8_t pwr_pcnt) {
 	if (temp > 4095) temp = 4095;
 	char p_buff[5];
-	sprintf(p_buff, "%3d%c", pwr_pcnt, '%');
+	fmtStr(fmtInt(p_buff, pwr_pcnt, 3), "%");
 	const char *title_buff 	= "Tune";
 	char mtemp_buff[6];
-	sprintf(mtemp_buff, "%3d", tune_temp);
+	fmtInt(mtemp_buff, tune_temp, 3);
 	char sym[2]			= "C";
 	U8G2::setFont(u8g_font_profont15r);
 	uint8_t pcnt_width = U8G2::getStrWidth(p_buff) + 5;
@@ -415,6 +639,14 @@ void  DSPL::tuneShow(uint16_t tune_temp, uint16_t temp, uint8_t pwr_pcnt) {
 	}
 	uint8_t pos_450		= map(3600, 2049, 4095, 20, d_width-16) + 8;
 
+	TUNE_VIEW view;
+	memset(&view, 0, sizeof(view));
+	view.tune_temp	= tune_temp;
+	view.pwr_pcnt	= pwr_pcnt;
+	view.t_len		= t_len;
+	strcpy(view.msg, msg_buff);
+	if (!viewChanged(VIEW_TUNE, &view, sizeof(view))) return;
+
 	U8G2::clearBuffer();
 	// Show title
 	uint8_t width = U8G2::getStrWidth(title_buff);
@@ -442,13 +674,14 @@ void  DSPL::tuneShow(uint16_t tune_temp, uint16_t temp, uint8_t pwr_pcnt) {
 	U8G2::drawBitmap(d_width-16, d_height-12, 1, 5, bmDegree);
 	U8G2::drawStr(d_width-width, d_height, mtemp_buff);
 	U8G2::drawStr(d_width-8, d_height, sym);
-	U8G2::sendBuffer();
+	sendBuffer();
+	viewSave(VIEW_TUNE, &view, sizeof(view));
 }
 
 void DSPL::pidInit(void) {
 	data_index 		= 0;
 	full_buff		= false;
-	default_mode	= 0;
+	default_mode.cancel();
 }
 
 void DSPL::pidSetLowerAxisLabel(const char *label) {
@@ -459,13 +692,13 @@ void DSPL::pidSetLowerAxisLabel(const char *label) {
 
 void DSPL::pidModify(uint8_t index, uint16_t value) {
 	if (index < 3) {
-		default_mode	= HAL_GetTick() + 1000;						// Show new value for 1 second
-		sprintf(modified_value, k_proto[index], value);
+		default_mode.start(1000);									// Show new value for 1 second
+		fmtInt(fmtStr(modified_value, k_proto[index]), value, 5);
 	}
 }
 
 void DSPL::autoPidInfo(const char *message) {
-	default_mode	= HAL_GetTick() + 2000;							// Show the message for 2 seconds
+	default_mode.start(2000);										// Show the message for 2 seconds
 	for (uint8_t i = 0; i < 19; ++i) {
 		if (!(modified_value[i] = message[i]))
 			break;
@@ -474,8 +707,10 @@ void DSPL::autoPidInfo(const char *message) {
 }
 
 void DSPL::autoPidCurrentLoop(uint16_t loop, uint32_t period) {
-	default_mode	= HAL_GetTick() + 50000;						// Show new value for 50 seconds, near forever
-	sprintf(modified_value, "#%d, P=%ld.%03ds", loop, period/1000, (uint16_t)period%1000);
+	default_mode.start(50000);										// Show new value for 50 seconds, near forever
+	char *p = fmtInt(fmtStr(modified_value, "#"), loop);
+	p = fmtInt(fmtStr(p, ", P="), period/1000);
+	fmtStr(fmtInt(fmtStr(p, "."), period%1000, 3, '0'), "s");
 }
 
 void DSPL::pidPutData(int16_t temp, uint16_t disp) {
@@ -554,26 +789,21 @@ void DSPL::pidShowGraph(uint8_t pwr) {
 	if (max_t > 999) {
 		max_t_buff[0] = '\0';
 	} else {
-		sprintf(max_t_buff, "%2d", max_t);								// The temperature amplitude
+		fmtInt(max_t_buff, max_t, 2);								// The temperature amplitude
 	}
 
 	char pwr_buff[8];
-	sprintf(pwr_buff, "%2d%c", pwr, '%');
+	fmtStr(fmtInt(pwr_buff, pwr, 2), "%");
 
 	// Check for temporary data instead of dispersion graph
-	bool show_disp = true;
-	if (default_mode && default_mode > HAL_GetTick()) {
-		show_disp = false;
-	} else {
-		default_mode = 0;
-	}
+	bool show_disp = (default_mode.remaining() == 0);
 
 	bool show_disp_value = false;
 	int8_t last = data_index - 1;
 	if (last < 0) last = 99;
 	char disp_value[4];
 	if (max_d <= 999) {
-		sprintf(disp_value, "%3d", max_d);
+		fmtInt(disp_value, max_d, 3);
 		show_disp_value = true;
 	}
 
@@ -606,7 +836,7 @@ void DSPL::pidShowGraph(uint8_t pwr) {
 	} else {
 		U8G2::drawStr(0, 62, modified_value);
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 void DSPL::pidShowMenu(uint16_t pid_k[3], uint8_t index) {
@@ -621,13 +851,13 @@ void DSPL::pidShowMenu(uint16_t pid_k[3], uint8_t index) {
 	U8G2::drawHLine((d_width-width)/2, 15, width);
 	// Show the Coefficient values
 	for (uint8_t i = 0; i < 3; ++i) {
-		sprintf(buff, k_proto[i], pid_k[i]);
+		fmtInt(fmtStr(buff, k_proto[i]), pid_k[i], 5);
 		U8G2::drawStr(20, 28+i*13, buff);
 		if (index == i) {
 			U8G2::drawBitmap(0, 20+i*13, 1, 7, bmLeftMark);
 		}
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 void DSPL::calibShow(const char* tip_name, uint8_t ref_point, uint16_t current_temp, uint16_t real_temp, bool celsius,
@@ -642,7 +872,7 @@ void DSPL::calibShow(const char* tip_name, uint8_t ref_point, uint16_t current_t
 	else
 		sym[0] = 'F';
 	char ref_buff[16];
-	sprintf(ref_buff, "Ref# %d", ref_point);
+	fmtInt(fmtStr(ref_buff, "Ref# "), ref_point);
 
 	uint8_t p_height = gauge(power, 10, 45);						// Applied power triangle height
 
@@ -662,7 +892,7 @@ void DSPL::calibShow(const char* tip_name, uint8_t ref_point, uint16_t current_t
 	U8G2::drawStr(5, 33, ref_buff);
 	// Show current temperature
 	char temp_buff[10];
-	sprintf(temp_buff, "%3d", current_temp);
+	fmtInt(temp_buff, current_temp, 3);
 	U8G2::drawBitmap(5, 57-15, 1, 15, bmTemperature);
 	width = U8G2::getStrWidth(temp_buff);
 	U8G2::drawStr(16, 57, temp_buff);
@@ -671,7 +901,7 @@ void DSPL::calibShow(const char* tip_name, uint8_t ref_point, uint16_t current_t
 	if (ready) {
 		// Show real temperature
 		U8G2::drawBitmap(70, 57-7, 1, 7, bmLeftMark);
-		sprintf(temp_buff, "%3d", real_temp);
+		fmtInt(temp_buff, real_temp, 3);
 		U8G2::drawStr(80, 57, temp_buff);
 	}
 	// Show the power applied
@@ -691,7 +921,7 @@ void DSPL::calibShow(const char* tip_name, uint8_t ref_point, uint16_t current_t
 	if (int_temp_pcnt > 1) {
 		U8G2::drawBox(14, 62, int_temp_pcnt, 2);
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 //---------------------- The Calibration display function ------------------------
@@ -709,7 +939,7 @@ void DSPL::calibManualShow(const char* tip_name, uint16_t ref_temp, uint16_t cur
 	else
 		sym[0] = 'F';
 	char ref_buff[16];
-	sprintf(ref_buff, "Set: %3d", ref_temp);
+	fmtInt(fmtStr(ref_buff, "Set: "), ref_temp, 3);
 
 	uint8_t p_height = 0;										  		// Applied power triangle height
 	if (power <= 10)
@@ -780,7 +1010,7 @@ void DSPL::calibManualShow(const char* tip_name, uint16_t ref_temp, uint16_t cur
 		width = U8G2::getStrWidth(OFF);
 		U8G2::drawStr(d_width-width-5, 33, OFF);
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 //---------------------- The Menu list display functions -------------------------
@@ -811,7 +1041,7 @@ void DSPL::tipListShow(const char* title,  TIP_ITEM list[], uint8_t list_len, ui
 			}
 		}
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 void DSPL::menuItemShow(const char* title, const char* item, const char* value, bool modify) {
@@ -840,7 +1070,7 @@ void DSPL::menuItemShow(const char* title, const char* item, const char* value,
 	} else {
 		U8G2::drawStr((d_width-width)/2, 45, item);
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 void DSPL::errorShow(void) {
@@ -877,7 +1107,7 @@ void DSPL::errorShow(void) {
 			start = finish + 1;
 		}
 	}
-	U8G2::sendBuffer();
+	sendBuffer();
 }
 
 void DSPL::errorMessage(const char *msg) {
@@ -888,20 +1118,26 @@ void DSPL::errorMessage(const char *msg) {
 	}
 }
 
-void DSPL::debugShow(bool gun_mode, uint16_t power, bool iron, bool gun, uint16_t data[4]) {
+void DSPL::debugShow(bool gun_mode, uint16_t power, bool iron, bool gun, uint16_t data[4], uint8_t idle_pcnt) {
 	char buff[14];
 	U8G2::setFont(u8g_font_profont15r);
 	U8G2::clearBuffer();
 	if (gun_mode) U8G2::drawBitmap(0, 0, 2, 16, bmFan[0]);
-	sprintf(buff, "%5d", power);
+	fmtInt(buff, power, 5);
 	U8G2::drawStr(0,  30, buff);
 	for (uint8_t i = 0; i < 4; ++i) {
-		sprintf(buff, "%5d", data[i]);
+		fmtInt(buff, data[i], 5);
 		U8G2::drawStr(60,  15*(i+1), buff);
 	}
-	sprintf(buff, "(%c-%c)", iron?'i':' ', gun?'g':' ');
+	fmtStr(buff, "( - )");
+	if (iron)	buff[1] = 'i';
+	if (gun)	buff[3] = 'g';
 	U8G2::drawStr(5,  58, buff);
-	U8G2::sendBuffer();
+	fmtInt(fmtStr(buff, "r"), render_us, 4);							// Main screen render time, mks
+	U8G2::drawStr(0,  45, buff);
+	fmtStr(fmtInt(buff, idle_pcnt, 3), "%");							// The CPU idle time
+	U8G2::drawStr(20, 15, buff);
+	sendBuffer();
 }
 
 void DSPL::showVersion(void) {
@@ -914,16 +1150,109 @@ void DSPL::showVersion(void) {
 	U8G2::drawStr((d_width-width)/2, 13, title);
 	U8G2::drawHLine((d_width-width)/2, 15, width);
 	// Show title
-	sprintf(buff, "IRON & Hot Air Gun");
+	fmtStr(buff, "IRON & Hot Air Gun");
 	width	= U8G2::getStrWidth(buff);
 	U8G2::drawStr((d_width-width)/2, 30, buff);
 	// Show software version
-	sprintf(buff, "Controller v.%s", FW_VERSION);
+	fmtStr(fmtStr(buff, "Controller v."), FW_VERSION);
 	width	= U8G2::getStrWidth(buff);
 	U8G2::drawStr((d_width-width)/2, 45, buff);
 	// Print date of compilation
-	sprintf(buff, "%s", __DATE__);
+	fmtStr(buff, __DATE__);
 	width	= U8G2::getStrWidth(buff);
 	U8G2::drawStr((d_width-width)/2, 61, buff);
-	U8G2::sendBuffer();
+	sendBuffer();
+}
+
+/*
+ * Show the flight recorder data: the temperature graph, the applied power bars and the cursor.
+ * The graph is scaled to the data range, one record per pixel column
+ */
+void DSPL::flightShow(FLREC *rec, uint8_t cursor, bool gun, const char *info) {
+	const uint8_t graph_top		= 16;							// The temperature graph top line
+	const uint8_t graph_bottom	= 50;							// The temperature graph bottom line
+	const uint8_t pwr_bottom	= 63;							// The power bars bottom line
+	const uint8_t pwr_height	= 11;							// The power bars height
+	uint8_t		len		= rec->size();
+	uint16_t	min_t	= 0xffff;
+	uint16_t	max_t	= 0;
+	uint16_t	max_p	= 1;
+	for (uint8_t i = 0; i < len; ++i) {
+		const FLREC_ENTRY &e = rec->read(i);
+		uint16_t t = gun?e.gun_temp:e.iron_temp;
+		uint16_t p = gun?e.gun_pwm:e.iron_pwm;
+		if (t < min_t) min_t = t;
+		if (t > max_t) max_t = t;
+		if (p > max_p) max_p = p;
+	}
+	if (max_t <= min_t) max_t = min_t + 1;
+
+	U8G2::setFont(u8g_font_profont15r);
+	U8G2::clearBuffer();
+	U8G2::drawStr(0, 12, info);
+	int8_t prev_y = 0;
+	for (uint8_t i = 0; i < len && i < d_width; ++i) {
+		const FLREC_ENTRY &e = rec->read(i);
+		uint16_t t = gun?e.gun_temp:e.iron_temp;
+		uint16_t p = gun?e.gun_pwm:e.iron_pwm;
+		int8_t y = graph_bottom - (uint32_t)(t - min_t) * (graph_bottom - graph_top) / (max_t - min_t);
+		if (i > 0) U8G2::drawLine(i-1, prev_y, i, y);
+		prev_y = y;
+		uint8_t h = (uint32_t)p * pwr_height / max_p;
+		if (h) U8G2::drawVLine(i, pwr_bottom - h + 1, h);
+		if (e.flags & (FLR_IRON_HOT | FLR_GUN_HOT))
+			U8G2::drawPixel(i, graph_top - 1);					// Mark the overheat records
+	}
+	for (uint8_t y = graph_top; y < pwr_bottom; y += 2)
+		U8G2::drawPixel(cursor, y);								// Dotted cursor line
+	sendBuffer();
+}
+
+// Show the duration of the controller startup phases (ms) and total startup time
+void DSPL::bootShow(uint16_t phase_ms[6]) {
+	static const char *title = "Startup, ms";
+	static const char *phase_name[6] = { "Dsp", "Cfg", "Tim", "AC", "Rdy", "Tot" };
+	char buff[10];
+	U8G2::setFont(u8g_font_profont15r);
+	U8G2::clearBuffer();
+	uint8_t width	= U8G2::getStrWidth(title);
+	U8G2::drawStr((d_width-width)/2, 13, title);
+	U8G2::drawHLine((d_width-width)/2, 15, width);
+	for (uint8_t i = 0; i < 6; ++i) {
+		fmtInt(fmtStr(buff, phase_name[i], 3), phase_ms[i], 5);
+		U8G2::drawStr((i & 1)?66:0, 30 + (i >> 1)*15, buff);
+	}
+	sendBuffer();
+}
+
+// Show the usage statistics of the tip: health (or -1 if unknown), heater time, heat cycles, energy (J) and the Hot Air Gun working time
+void DSPL::usageShow(const char *tip_name, int8_t health, uint32_t iron_sec, uint16_t cycles, uint32_t energy, uint32_t gun_sec,
+		const char *dropped_tip) {
+	char buff[20];
+	U8G2::setFont(u8g_font_profont15r);
+	U8G2::clearBuffer();
+	char *p = fmtStr(buff, tip_name);
+	if (health >= 0) {
+		p = fmtInt(p, health, 5);
+		*p++ = '%';
+		*p   = '\0';
+	}
+	uint8_t width	= U8G2::getStrWidth(buff);
+	U8G2::drawStr((d_width-width)/2, 13, buff);
+	U8G2::drawHLine((d_width-width)/2, 15, width);
+	p = fmtInt(fmtStr(buff, "Time", 5), iron_sec / 3600, 6);
+	*p++ = ':';
+	fmtInt(p, (iron_sec / 60) % 60, 2, '0');
+	U8G2::drawStr(0, 30, buff);
+	fmtInt(fmtStr(fmtInt(fmtStr(buff, "Cyc", 3), cycles, 5), " Wh", 3), (energy + 1800) / 3600, 6);
+	U8G2::drawStr(0, 45, buff);
+	if (dropped_tip) {										// The statistics area is full, the history of this tip was overwritten
+		fmtStr(fmtStr(buff, "Lost "), dropped_tip);
+	} else {
+		p = fmtInt(fmtStr(buff, "Gun", 5), gun_sec / 3600, 6);
+		*p++ = ':';
+		fmtInt(p, (gun_sec / 60) % 60, 2, '0');
+	}
+	U8G2::drawStr(0, 60, buff);
+	sendBuffer();
 }
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include "eeprom.h"
 #include "iron_tips.h"
+#include "oled.h"
 
 bool EEPROM::init(void) {
 	// Read all the records in the EEPROM and find min and max record IDs
@@ -24,6 +25,19 @@ bool EEPROM::init(void) {
 	}
 
 	can_write = true;
+#ifdef EEPROM_MIRROR
+	if (!mirror_loaded) {									// Load the configuration and statistics areas into the mirror once
+		for (uint16_t chunk = 0; chunk < eeprom_mirror_chunks; ++chunk) {
+			if (!readEEPROM(chunk, &mirror[chunk * eeprom_chunk_size])) {
+				can_write = false;
+				return can_write;
+			}
+		}
+		mirror_loaded	= true;
+		chunk_in_data	= 65535;
+	}
+#endif
+	upgradeConfigArea();
 	for (uint16_t chunk = 0; chunk < cfg_chunks; ++chunk) {
 		if (readChunk(chunk)) {
 			RECORD* cfg = (RECORD*)data;
@@ -46,6 +60,7 @@ bool EEPROM::init(void) {
 		}
 	}
 
+	scanStats();
 	if (records == 0) {
 		w_chunk		= r_chunk = 0;
 	    return can_write;
@@ -138,6 +153,14 @@ TIP_IO_STATUS EEPROM::saveTipData(TIP* tip, uint8_t tip_chunk_index) {
 void EEPROM::clearConfigArea(void) {
 	for (uint8_t i = 0; i < eeprom_chunk_size; ++i)
 		data[i] = 0xFF;
+	chunk_in_data = 65535;
+#ifdef EEPROM_MIRROR
+	if (mirror_loaded) {
+		memset(mirror, 0xFF, cfg_chunks * eeprom_chunk_size);
+		for (uint16_t chunk = 0; chunk < cfg_chunks; ++chunk)	// The configuration area is written below
+			dirty[chunk >> 5] &= ~(1 << (chunk & 0x1F));
+	}
+#endif
 	for (int i = 0; i < cfg_chunks; ++i) {
 		uint32_t addr = i * eeprom_chunk_size;
 		if (HAL_I2C_Mem_Write(hi2c, eeprom_address<<1, addr, I2C_MEMADD_SIZE_16BIT, data, eeprom_chunk_size, 100) != HAL_OK) {
@@ -148,6 +171,147 @@ void EEPROM::clearConfigArea(void) {
 	init();
 }
 
+/*
+ * The previous firmware versions used the chunks 0-63 for the configuration records, so after the upgrade
+ * the newest record can be in the statistics area. Copy the newest record into the configuration area
+ * instead of its oldest record and clear the old configuration records in the statistics area.
+ * The chunk is the old configuration record if it has correct configuration checksum and it is not a statistics record.
+ * Nothing is changed when the statistics area has no configuration records, i.e. after the first boot
+ */
+void EEPROM::upgradeConfigArea(void) {
+	RECORD		rec;
+	uint32_t	max_id		= 0;							// The newest record in whole old configuration area
+	uint16_t	max_ch		= 0;
+	uint32_t	min_id		= 0xffffffff;					// The oldest record in the new configuration area
+	uint16_t	min_ch		= 0;
+	uint16_t	old_records	= 0;
+	for (uint16_t chunk = 0; chunk < stat_first + stat_chunks; ++chunk) {
+		if (!readChunk(chunk)) return;
+		memcpy(&rec, data, sizeof(RECORD));					// CFG_checkSum() modifies the record
+		bool cfg_ok = CFG_checkSum(&rec, false);
+		if (chunk < cfg_chunks) {
+			uint32_t id = cfg_ok?rec.ID:0;					// The broken record is replaced first
+			if (id < min_id) {
+				min_id	= id;
+				min_ch	= chunk;
+			}
+		} else if (cfg_ok) {
+			STATS st;
+			memcpy(&st, data, sizeof(STATS));
+			if (STAT_checkSum(&st, false)) continue;		// The statistics record
+			++old_records;
+		}
+		if (cfg_ok && rec.ID > max_id) {
+			max_id	= rec.ID;
+			max_ch	= chunk;
+		}
+	}
+	if (old_records == 0) return;
+
+	if (max_ch >= cfg_chunks) {								// The newest record is in the statistics area
+		if (!readChunk(max_ch) || !writeChunk(min_ch)) return;
+	}
+	for (uint16_t chunk = cfg_chunks; chunk < stat_first + stat_chunks; ++chunk) {
+		if (!readChunk(chunk)) return;
+		memcpy(&rec, data, sizeof(RECORD));
+		STATS st;
+		memcpy(&st, data, sizeof(STATS));
+		if (CFG_checkSum(&rec, false) && !STAT_checkSum(&st, false)) {
+			memset(data, 0xFF, eeprom_chunk_size);
+			if (!writeChunk(chunk)) return;
+		}
+	}
+	writeBack(true);										// The configuration area chunk is saved first
+}
+
+// Read the statistics area and remember the IDs and the tip indexes of the correct records
+void EEPROM::scanStats(void) {
+	stat_max_id = 0;
+	for (uint8_t i = 0; i < stat_chunks; ++i) {
+		stat_id[i]	= 0;
+		stat_tip[i]	= 0;
+		if (readChunk(stat_first + i)) {
+			STATS* st = (STATS*)data;
+			if (STAT_checkSum(st, false) && st->ID != 0) {
+				stat_id[i]	= st->ID;
+				stat_tip[i]	= st->tip;
+				if (st->ID > stat_max_id) stat_max_id = st->ID;
+			}
+		}
+	}
+}
+
+int8_t EEPROM::statChunk(uint8_t tip) {
+	int8_t		chunk	= -1;
+	uint32_t	id		= 0;
+	for (uint8_t i = 0; i < stat_chunks; ++i) {
+		if (stat_id[i] && stat_tip[i] == tip && stat_id[i] > id) {
+			id		= stat_id[i];
+			chunk	= i;
+		}
+	}
+	return chunk;
+}
+
+bool EEPROM::loadStats(STATS* stats, uint8_t tip) {
+	int8_t chunk = statChunk(tip);
+	if (chunk < 0 || !readChunk(stat_first + chunk)) return false;
+	memcpy(stats, data, sizeof(STATS));
+	return STAT_checkSum(stats, false);
+}
+
+// Load the record from n-th chunk of the statistics area if this is the actual record of some tip
+bool EEPROM::loadStatsRecord(STATS* stats, uint8_t n) {
+	if (n >= stat_chunks || stat_id[n] == 0 || statChunk(stat_tip[n]) != n) return false;
+	if (!readChunk(stat_first + n)) return false;
+	memcpy(stats, data, sizeof(STATS));
+	return STAT_checkSum(stats, false);
+}
+
+bool EEPROM::loadLastStats(STATS* stats) {
+	for (uint8_t i = 0; i < stat_chunks; ++i) {
+		if (stat_id[i] && stat_id[i] == stat_max_id)
+			return loadStats(stats, stat_tip[i]);
+	}
+	return false;
+}
+
+/*
+ * Write the statistics record to the chunk that is empty or has the oldest record superseded by the newer record of the same tip.
+ * If every chunk holds the actual record of the different tip, overwrite the oldest one
+ */
+bool EEPROM::saveStats(STATS* stats) {
+	if (!can_write) return can_write;
+
+	int8_t chunk	= -1;
+	int8_t oldest	= 0;
+	for (uint8_t i = 0; i < stat_chunks; ++i) {
+		if (stat_id[i] == 0) {								// Empty chunk
+			chunk = i;
+			break;
+		}
+		if (stat_id[i] < stat_id[oldest]) oldest = i;
+		bool superseded = (stat_tip[i] == stats->tip) || (statChunk(stat_tip[i]) != i);
+		if (superseded && (chunk < 0 || stat_id[i] < stat_id[chunk]))
+			chunk = i;
+	}
+	if (chunk < 0) {										// The area is full of actual records of other tips
+		chunk			= oldest;
+		stat_dropped	= stat_tip[oldest];
+	}
+
+	stats->ID		= ++stat_max_id;
+	STAT_checkSum(stats, true);
+	if (!readChunk(stat_first + chunk)) return false;
+	memcpy(data, stats, sizeof(STATS));
+	if (writeChunk(stat_first + chunk)) {
+		stat_id[chunk]	= stats->ID;
+		stat_tip[chunk]	= stats->tip;
+		return true;
+	}
+	return false;
+}
+
 // Calculate the space required to store TIP configuration. (defined in config.h). The space size should be multiple by 2**N
 uint16_t EEPROM::requiredTipSpace(void) {
 	uint16_t tip_sz = sizeof(TIP);
@@ -164,11 +328,33 @@ bool EEPROM::readChunk(uint16_t chunk_index) {
 	if (chunk_index == chunk_in_data) return true;
 	if (chunk_index >= eeprom_chunks) return false;
 
-	uint16_t addr = chunk_index * eeprom_chunk_size;
-	if (HAL_I2C_Mem_Read(hi2c, eeprom_address<<1, addr, I2C_MEMADD_SIZE_16BIT, data, eeprom_chunk_size, 100) == HAL_OK) {
+#ifdef EEPROM_MIRROR
+	if (mirror_loaded && chunk_index < eeprom_mirror_chunks) {
+		uint8_t *chunk = &mirror[chunk_index * eeprom_chunk_size];
+		if (reload_chunk) {									// Refresh the mirror with the actual EEPROM data
+			reload_chunk = false;
+			if (!readEEPROM(chunk_index, chunk))
+				return false;
+		}
+		memcpy(data, chunk, eeprom_chunk_size);
+		chunk_in_data = chunk_index;
+		return true;
+	}
+	int8_t slot = tipCacheSlot(chunk_index);
+	if (slot >= 0 && !reload_chunk) {
+		memcpy(data, &tip_cache[slot * eeprom_chunk_size], eeprom_chunk_size);
 		chunk_in_data = chunk_index;
 		return true;
 	}
+	reload_chunk = false;
+#endif
+	if (readEEPROM(chunk_index, data)) {
+		chunk_in_data = chunk_index;
+#ifdef EEPROM_MIRROR
+		tipCacheStore(chunk_index);
+#endif
+		return true;
+	}
 	return false;
 }
 
@@ -176,17 +362,113 @@ bool EEPROM::readChunk(uint16_t chunk_index) {
 bool EEPROM::writeChunk(uint16_t chunk_index) {
 	if (chunk_index >= eeprom_chunks) return false;
 
-	uint16_t addr = chunk_index * eeprom_chunk_size;
+#ifdef EEPROM_MIRROR
+	if (mirror_loaded && chunk_index < eeprom_mirror_chunks) {	// Update the mirror only, see writeBack()
+		memcpy(&mirror[chunk_index * eeprom_chunk_size], data, eeprom_chunk_size);
+		dirty[chunk_index >> 5] |= 1 << (chunk_index & 0x1F);
+		wb_timer.start(wb_delay);
+		chunk_in_data	= chunk_index;
+		return true;
+	}
+#endif
 	chunk_in_data = eeprom_chunks;							// Mark the buffer as dirty
-	if (HAL_I2C_Mem_Write(hi2c, eeprom_address<<1, addr, I2C_MEMADD_SIZE_16BIT, data, eeprom_chunk_size, 100) == HAL_OK) {
+	if (writeEEPROM(chunk_index, data)) {
 		chunk_in_data = chunk_index;
-		HAL_Delay(20);
+#ifdef EEPROM_MIRROR
+		tipCacheStore(chunk_index);							// Write through the tip cache
+#endif
 		return true;
 	}
-	HAL_Delay(20);
+#ifdef EEPROM_MIRROR
+	int8_t slot = tipCacheSlot(chunk_index);
+	if (slot >= 0) tip_cache_chunk[slot] = 0;				// The chunk content is unknown now
+#endif
 	return false;
 }
 
+#ifdef EEPROM_MIRROR
+int8_t EEPROM::tipCacheSlot(uint16_t chunk_index) {
+	for (uint8_t i = 0; i < eeprom_tip_cache; ++i) {
+		if (tip_cache_chunk[i] == chunk_index)
+			return i;
+	}
+	return -1;
+}
+
+// Keep the chunk in the tip cache, the slots are replaced round robin
+void EEPROM::tipCacheStore(uint16_t chunk_index) {
+	if (chunk_index < eeprom_mirror_chunks) return;
+	int8_t slot = tipCacheSlot(chunk_index);
+	if (slot < 0) {
+		slot = tip_cache_next;
+		if (++tip_cache_next >= eeprom_tip_cache) tip_cache_next = 0;
+		tip_cache_chunk[slot] = chunk_index;
+	}
+	memcpy(&tip_cache[slot * eeprom_chunk_size], data, eeprom_chunk_size);
+}
+#endif
+
+// Disable the cache: next readChunk() reads the chunk from the EEPROM IC
+void EEPROM::forceReloadChunk(void) {
+	chunk_in_data	= 65535;
+#ifdef EEPROM_MIRROR
+	writeBack(true);										// Save all the changes before verifying them
+	reload_chunk	= mirror_loaded;
+#endif
+}
+
+/*
+ * Write modified chunks of the RAM mirror to the EEPROM IC. Called periodically from the main loop.
+ * Wait for wb_delay ms after last change to save several changes of the same chunk by one write
+ * If force is true, write the dirty chunks immediately
+ */
+void EEPROM::writeBack(bool force) {
+#ifdef EEPROM_MIRROR
+	if (!mirror_loaded || !can_write) return;
+	if (!force && !wb_timer.expired()) return;
+	for (uint16_t chunk = 0; chunk < eeprom_mirror_chunks; ++chunk) {
+		uint32_t mask = 1 << (chunk & 0x1F);
+		if (dirty[chunk >> 5] & mask) {
+			if (!writeEEPROM(chunk, &mirror[chunk * eeprom_chunk_size])) {
+				wb_timer.start(wb_delay);					// Try again later
+				return;
+			}
+			dirty[chunk >> 5] &= ~mask;
+		}
+	}
+#endif
+}
+
+/*
+ * The I2C bus is shared with the display that sends the frame by DMA. The bus is free for a short time between
+ * the transfers of the frame, the DMA complete interrupt starts the next transfer. So wait till the whole frame is sent.
+ * The frames are started by the main loop only, no new frame can start while the EEPROM is accessed
+ */
+bool EEPROM::busReady(void) {
+	oledWait();
+	uint32_t start = HAL_GetTick();
+	while (HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY) {
+		if (HAL_GetTick() - start >= 100) return false;
+	}
+	return true;
+}
+
+// Read the chunk from the EEPROM IC to the buffer
+bool EEPROM::readEEPROM(uint16_t chunk_index, uint8_t *buff) {
+	if (!busReady()) return false;
+	uint16_t addr = chunk_index * eeprom_chunk_size;
+	return (HAL_I2C_Mem_Read(hi2c, eeprom_address<<1, addr, I2C_MEMADD_SIZE_16BIT, buff, eeprom_chunk_size, 100) == HAL_OK);
+}
+
+// Write the buffer to the EEPROM IC chunk and wait till the data saved
+bool EEPROM::writeEEPROM(uint16_t chunk_index, uint8_t *buff) {
+	if (!busReady()) return false;
+	uint16_t addr = chunk_index * eeprom_chunk_size;
+	bool ok = (HAL_I2C_Mem_Write(hi2c, eeprom_address<<1, addr, I2C_MEMADD_SIZE_16BIT, buff, eeprom_chunk_size, 100) == HAL_OK);
+	HAL_Delay(20);
+	return ok;
+}
+
 // Checks the CRC of the RECORD structure. Returns true if OK. Replace the CRC with the correct value if write is true
 uint8_t EEPROM::CFG_checkSum(RECORD* cfg, bool write) {
 	uint16_t 	summ 		= 117;							// To avoid good check sum with all-zero, start with 117
@@ -201,6 +483,19 @@ uint8_t EEPROM::CFG_checkSum(RECORD* cfg, bool write) {
 	return res;
 }
 
+// Checks the CRC of the STATS structure. Returns true if OK. Replace the CRC with the correct value if write is true
+bool EEPROM::STAT_checkSum(STATS* stats, bool write) {
+	uint16_t 	summ 		= 117;							// To avoid good check sum with all-zero, start with 117
+	uint16_t    rec_summ 	= stats->crc;
+	stats->crc				= 0;
+	uint8_t*	d 			= (uint8_t*)stats;
+	for (uint8_t i = 0; i < sizeof(STATS); ++i) {
+		summ = (summ << 1) | (summ >> 15); summ += d[i];	// Rotate, so every byte affects the sum
+	}
+	stats->crc = write?summ:rec_summ;
+	return (rec_summ == summ);
+}
+
 // Checks the CRC inside tip structure. Returns true if OK, replaces the CRC with the correct value
 uint8_t EEPROM::TIP_checkSum(TIP* tip, bool write) {
 	uint32_t summ = tip->t200;
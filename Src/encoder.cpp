@@ -7,23 +7,32 @@
 
 #include "encoder.h"
 
+/*
+ * Gray code transition table: +1 or -1 for valid quarter step, 0 for no change or invalid transition (both channels changed).
+ * The bounce of the contacts produces forward and backward steps that cancel each other.
+ */
+const int8_t RENC::q_table[16] = {
+	0, -1,  1,  0,
+	1,  0,  0, -1,
+   -1,  0,  0,  1,
+	0,  1, -1,  0
+};
+
 RENC::RENC(GPIO_TypeDef* aPORT, uint16_t aPIN, GPIO_TypeDef* bPORT, uint16_t bPIN) {
-	rpt 		= 0;
 	m_port 		= aPORT; s_port = bPORT; m_pin = aPIN; s_pin = bPIN;
 	pos 		= 0;
 	min_pos 	= -32767; max_pos = 32766; increment = 1;
 	changed 	= 0;
-	s_up		= false;
 	is_looped	= false;
 	increment	= fast_increment = 1;
 }
 
 void RENC::addButton(GPIO_TypeDef* ButtonPORT, uint16_t ButtonPIN) {
 	bpt 		= 0;
-	b_port 		= ButtonPORT;
 	b_pin  		= ButtonPIN;
 	over_press	= def_over_press;
-	avg.length(avg_length);
+	b_head		= b_tail = 0;
+	b_port 		= ButtonPORT;								// Set the port last, it enables buttonTick()
 }
 
 void RENC::reset(int16_t initPos, int16_t low, int16_t upp, uint8_t inc, uint8_t fast_inc, bool looped) {
@@ -32,6 +41,8 @@ void RENC::reset(int16_t initPos, int16_t low, int16_t upp, uint8_t inc, uint8_t
 	increment = fast_increment = inc;
 	if (fast_inc > increment) fast_increment = fast_inc;
 	is_looped = looped;
+	accel_on  = !looped && (increment > 0) && ((max_pos - min_pos) / increment >= accel_range);
+	d_dir	  = 0;
 }
 
 /*
@@ -39,49 +50,76 @@ void RENC::reset(int16_t initPos, int16_t low, int16_t upp, uint8_t inc, uint8_t
  * 0	- not pressed
  * 1	- short press
  * 2	- long press
+ * The press duration is calculated by the event time stamps, so it does not depend on how often this method is called
  */
 uint8_t	RENC::buttonStatus(void) {
-	if (HAL_GetTick() >= b_check) {							// It is time to check the button status
-		b_check = HAL_GetTick() + b_check_period;
-		uint8_t s = 0;
-		if (GPIO_PIN_RESET == HAL_GPIO_ReadPin(b_port, b_pin))	// if port state is low, the button pressed
-			s = trigger_on << 1;
-		if (b_on) {
-			if (avg.average(s) < trigger_off)
-				b_on = false;
-		} else {
-			if (avg.average(s) > trigger_on)
-				b_on = true;
-		}
-
-		if (b_on) {                                           	// Button status is 'pressed'
-			uint32_t n = HAL_GetTick() - bpt;
-			if ((bpt == 0) || (n > over_press)) {
-				bpt = HAL_GetTick();
-			} else if (n > long_press) {                    	// Long press
-				if (i_b_rel) {
-					return 0;
-				} else{
-					i_b_rel = true;
-					return 2;
-				}
-			}
-		} else {                                            	// Button status is 'not pressed'
-			if (bpt == 0 || i_b_rel) {
-				bpt = 0;
-				i_b_rel = false;
-				return 0;
-			}
-			uint32_t e = HAL_GetTick() - bpt;
-			bpt = 0;											// Ready for next press
-			if (e < over_press) {								// Long press already managed
-				return 1;
-			}
+	BTN_EVENT ev;
+	while (buttonEvent(ev)) {
+		switch (ev.type) {
+			case BTN_PRESS:
+				b_press_t	= ev.time;
+				b_long_rep	= false;
+				break;
+			case BTN_LONG:
+				b_long_rep	= true;
+				return 2;
+			case BTN_RELEASE:
+				if (!b_long_rep && (ev.time - b_press_t) < over_press)	// Ignore the release after the long press
+					return 1;
+				break;
+			default:
+				break;
 		}
 	}
     return 0;
 }
 
+/*
+ * Sample the button every ms. The button status changes when the integrator of the readings reaches its limit,
+ * the event time is corrected by the debounce time to be the time of the first stable reading
+ */
+bool RENC::buttonTick(uint32_t now_t) {
+	if (!b_port) return false;
+	if (GPIO_PIN_RESET == HAL_GPIO_ReadPin(b_port, b_pin)) {	// if port state is low, the button pressed
+		if (b_integr < b_debounce) ++b_integr;
+	} else {
+		if (b_integr > 0) --b_integr;
+	}
+	if (!b_on && b_integr >= b_debounce) {
+		b_on	= true;
+		b_long	= false;
+		bpt		= now_t - b_debounce;
+		return pushButton(BTN_PRESS, bpt);
+	}
+	if (b_on && b_integr == 0) {
+		b_on	= false;
+		return pushButton(BTN_RELEASE, now_t - b_debounce);
+	}
+	if (b_on && !b_long && (now_t - bpt) >= long_press) {
+		b_long	= true;
+		return pushButton(BTN_LONG, now_t);
+	}
+	return false;
+}
+
+// Read the button event, the queue is filled by buttonTick() in the interrupt context
+bool RENC::buttonEvent(BTN_EVENT &ev) {
+	if (b_tail == b_head) return false;
+	ev		= b_queue[b_tail];
+	b_tail	= (b_tail + 1) & (BTN_QUEUE_LEN-1);
+	return true;
+}
+
+// Put the button event into the queue, the event is lost if the queue is full
+bool RENC::pushButton(uint8_t type, uint32_t time) {
+	uint8_t next = (b_head + 1) & (BTN_QUEUE_LEN-1);
+	if (next == b_tail) return false;
+	b_queue[b_head].type	= type;
+	b_queue[b_head].time	= time;
+	b_head	= next;
+	return true;
+}
+
 bool RENC::write(int16_t initPos)	{
 	if ((initPos >= min_pos) && (initPos <= max_pos)) {
 		pos = initPos;
@@ -91,30 +129,66 @@ bool RENC::write(int16_t initPos)	{
 }
 
 
-void RENC::encoderIntr(void) {					// Interrupt function, called when the channel A of encoder changed
-	bool mUp = (HAL_GPIO_ReadPin(m_port, m_pin) == GPIO_PIN_SET);
-	uint32_t now_t = HAL_GetTick();
-	if (!mUp) {                                     // The main channel has been "pressed"
-		if ((rpt == 0) || (now_t - rpt > over_press)) {
-			rpt = now_t;
-			s_up = (HAL_GPIO_ReadPin(s_port, s_pin) == GPIO_PIN_SET);
-    	}
-	} else {
-			if (rpt > 0) {
-				if (s_up == (HAL_GPIO_ReadPin(s_port, s_pin) == GPIO_PIN_RESET)) {	// Secondary channel polarity has been changed
-					uint8_t inc = increment;
-					if ((now_t - rpt) < over_press) {
-						if ((now_t - changed) < fast_timeout) inc = fast_increment;
-							changed = now_t;
-							if (s_up) pos -= inc; else pos += inc;
-							if (pos > max_pos) {
-								pos = (is_looped)?min_pos:max_pos;
-							} else if (pos < min_pos) {
-								pos = (is_looped)?max_pos:min_pos;
-							}
-					}
-				}
-				rpt = 0;
-			}
+void RENC::encoderIntr(void) {					// Interrupt function, called when any channel of encoder changed
+	uint8_t ab = 0;
+	if (HAL_GPIO_ReadPin(m_port, m_pin) == GPIO_PIN_SET) ab |= 2;
+	if (HAL_GPIO_ReadPin(s_port, s_pin) == GPIO_PIN_SET) ab |= 1;
+	quadrature(ab, HAL_GetTick());
+}
+
+/*
+ * Accumulate the quarter steps and count the detent when the encoder reaches the rest state.
+ * Two quarter steps in the same direction are enough, so the single lost edge does not lose the detent,
+ * and the accumulator is cleared in the rest state, so the bounce cannot produce the double count.
+ * If the edge to the rest state itself was lost, both channels change after three quarter steps:
+ * the encoder has passed the detent, count it and continue with the first quarter step of the next one.
+ */
+void RENC::quadrature(uint8_t ab, uint32_t now_t) {
+	ab &= 3;
+	int8_t q = q_table[(ab_state << 2) | ab];
+	if ((ab ^ ab_state) == 3 && (q_steps >= 3 || q_steps <= -3)) {
+		q = (q_steps > 0)?1:-1;
+		step(q, now_t);
+		q_steps = 0;
+	}
+	q_steps += q;
+	ab_state = ab;
+	if (ab == rest_state) {
+		if (q_steps >= 2) {
+			step(1, now_t);
+		} else if (q_steps <= -2) {
+			step(-1, now_t);
 		}
+		q_steps = 0;
+	}
+}
+
+// Change the encoder position by one detent, the increment depends on the rotation speed
+void RENC::step(int8_t dir, uint32_t now_t) {
+	uint32_t interval = now_t - changed;
+	uint16_t inc = increment;
+	if (interval < fast_timeout) inc = fast_increment;
+	if (dir != d_dir || interval >= accel_reset) {			// Start measuring the rotation speed again
+		d_interval = accel_reset;
+	} else {
+		d_interval = (d_interval + interval + 1) >> 1;		// Averaged interval between the detents
+	}
+	d_dir	= dir;
+	changed = now_t;
+	if (accel_on) inc *= acceleration(d_interval);
+	int32_t p = pos + dir * inc;
+	if (p > max_pos) {
+		p = (is_looped)?min_pos:max_pos;
+	} else if (p < min_pos) {
+		p = (is_looped)?max_pos:min_pos;
+	}
+	pos = p;
+}
+
+// The increment multiplier for the averaged interval between the detents (ms)
+uint8_t RENC::acceleration(uint32_t interval) {
+	if (interval <= 15)	return 10;
+	if (interval <= 25)	return 5;
+	if (interval <= 50)	return 2;
+	return 1;
 }
@@ -16,8 +16,8 @@ void HOTGUN::init(void) {
 	safetyRelay(false);										// Completely turn-off the power of Hot Air Gun
     h_power.reset();
 	h_temp.reset();
-	d_power.length(ec);
-	d_temp.length(ec);
+	d_power.reset();
+	d_temp.reset();
 	PID::init(1000, 13, false);								// Initialize PID for Hot Air Gun, 1Hz. Do not forcible heat!
     resetPID();
 }
@@ -57,7 +57,7 @@ void HOTGUN::updateTemp(uint16_t value) {
 }
 
 void HOTGUN::switchPower(bool On) {
-	fan_off_time = 0;										// Disable fan offline by timeout
+	fan_off_timer.cancel();									// Disable fan offline by timeout
 	switch (mode) {
 		case POWER_OFF:
 			if (fanSpeed() == 0) {							// No power supplied to the Fan
@@ -84,7 +84,7 @@ void HOTGUN::switchPower(bool On) {
 							shutdown();
 						} else {							// FAN && !On && connected && !cold
 							mode = POWER_COOLING;
-							fan_off_time = HAL_GetTick() + fan_off_timeout;
+							fan_off_timer.start(fan_off_timeout);
 							reach_cold_temp	= false;
 						}
 					}
@@ -96,7 +96,7 @@ void HOTGUN::switchPower(bool On) {
 		case POWER_PID_TUNE:
 			if (!On) {										// Start cooling the hot air gun
 				mode = POWER_COOLING;
-				fan_off_time = HAL_GetTick() + fan_off_timeout;
+				fan_off_timer.start(fan_off_timeout);
 				reach_cold_temp = false;
 			}
 			break;
@@ -110,7 +110,7 @@ void HOTGUN::switchPower(bool On) {
 							shutdown();
 						} else {							// FAN && !On && connected && !cold
 							mode = POWER_COOLING;
-							fan_off_time = HAL_GetTick() + fan_off_timeout;
+							fan_off_timer.start(fan_off_timeout);
 							reach_cold_temp = false;
 						}
 					}
@@ -138,7 +138,7 @@ void HOTGUN::switchPower(bool On) {
 				} else {									// FAN && !On
 					if (isConnected()) {
 						if (avg_sync_temp < temp_gun_cold) { // FAN && !On && connected && cold
-							fan_off_time = HAL_GetTick() + fan_extra_time;
+							fan_off_timer.start(fan_extra_time);
 							reach_cold_temp = true;
 						}
 					} else {								// FAN && !On && !connected
@@ -223,7 +223,7 @@ uint16_t HOTGUN::power(void) {
 					if (avg_sync_temp < temp_gun_cold) {	// FAN && connected && cold
 						if (!reach_cold_temp) {
 							reach_cold_temp = true;
-							fan_off_time = HAL_GetTick() + fan_extra_time;
+							fan_off_timer.start(fan_extra_time);
 						}
 					} else {								// FAN && connected && !cold
 						uint16_t fan = map(avg_sync_temp, temp_gun_cold, temp_set, max_cool_fan, min_fan_speed);
@@ -232,7 +232,7 @@ uint16_t HOTGUN::power(void) {
 					}
 				}
 				// Here the FAN is working but the Hot Air Gun can be disconnected
-				if (fan_off_time && HAL_GetTick() >= fan_off_time) { // The fan should be turned off in specific time
+				if (fan_off_timer.expired()) {						// The fan should be turned off in specific time
 					shutdown();
 				}
 			}
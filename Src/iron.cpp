@@ -13,13 +13,18 @@ void IRON::init(void) {
 	mode		= POWER_OFF;
 	fix_power	= 0;
 	chill		= false;
-	UNIT::init(iron_sw_len, iron_off_value,	iron_on_value,   sw_tilt_len, sw_off_value, sw_on_value);
-	t_iron_short.length(iron_emp_coeff);
-	t_amb.length(ambient_emp_coeff);
-	h_power.length(ec);
-	h_temp.length(ec);
-	d_power.length(ec);
-	d_temp.length(ec);
+	UNIT::init(iron_sw_len, iron_off_value,	iron_on_value,   sw_tilt_len, sw_off_value, sw_on_value, connect_confirm);
+	t_iron_short.reset();
+	kalman.setup(model_loss, model_gain, model_q_temp, model_q_error, model_adc_noise);
+	last_power	= 0;
+	t_amb.reset();
+	amb_samples	= 0;
+	amb_streak	= 0;
+	no_sensor	= false;
+	h_power.reset();
+	h_temp.reset();
+	d_power.reset();
+	d_temp.reset();
 	// The IRON is powered by TIM2, calculate the TIM2 period in ms
 	uint32_t tim2_period = (TIM2->PSC + 1) * (TIM2->ARR + 1);
 	uint32_t cpu_speed = SystemCoreClock / 1000;			// Calculate TIM2 period in ms
@@ -28,15 +33,40 @@ void IRON::init(void) {
 	resetPID();
 }
 
+/*
+ * The first reading initializes the average value, so the ambient temperature is ready just after startup.
+ * The open ambient sensor reads near the ADC maximum. The handle status changes when connect_confirm readings in a row
+ * disagree with it, then the average restarts from the new reading. A single disagreeing reading is not averaged
+ */
+void IRON::updateAmbient(uint32_t value) {
+	bool open = (value >= max_ambient_value);
+	if (amb_samples == 0) {
+		t_amb.preset(value);
+		no_sensor	= open;
+	} else if (open != no_sensor) {
+		if (++amb_streak < connect_confirm) return;
+		t_amb.preset(value);								// The IRON handle has been connected or disconnected
+		no_sensor	= open;
+		amb_streak	= 0;
+	} else {
+		t_amb.update(value);
+		amb_streak	= 0;
+	}
+	if (amb_samples < ambient_emp_coeff) ++amb_samples;
+}
+
 void IRON::switchPower(bool On) {
 	if (!On) {
 		fix_power	= 0;
 		if (mode != POWER_OFF)
 			mode = POWER_COOLING;							// Start the cooling process
+		sig_cnt		= 0;
 	} else {
 		resetPID();
 		temp_low	= 0;									// Disable low power mode
 		mode		= POWER_ON;
+		sig_ready	= false;
+		sig_cnt		= 1;									// Start measuring the heat-up signature, see measureSignature()
 	}
 	h_power.reset();
 	d_power.reset();
@@ -102,11 +132,19 @@ void IRON::adjust(uint16_t t) {
 
 // Called from HAL_ADC_ConvCpltCallback() event handler. See core.cpp for details.
 uint16_t IRON::power(int32_t t) {
+	int32_t raw		= t;
+#ifdef IRON_KALMAN
+	t				= kalman.update(t, last_power);			// Less noise and delay than the short term history average
+	if (t < 0) t = 0;
+#else
 	t				= tempShortAverage(t);					// Prevent temperature deviation using short term history average
+#endif
 	temp_curr		= t;
 	int32_t at 		= h_temp.average(temp_curr);
 	int32_t diff	= at - temp_curr;
 	d_temp.update(diff*diff);
+	settle.update(temp_curr);
+	approach.update(temp_curr);
 
 	if ((t >= int_temp_max + 100) || (t > (temp_set + 400))) {	// Prevent global over heating
 		if (mode == POWER_ON) chill = true;					// Turn off the power in main working mode only;
@@ -146,18 +184,62 @@ uint16_t IRON::power(int32_t t) {
 			break;
 	}
 
+	if (sig_cnt) p = measureSignature(raw, p);
+
 	int32_t	ap		= h_power.average(p);
 	diff 			= ap - p;
 	d_power.update(diff*diff);
+	last_power		= p;
 	return p;
 }
 
+/*
+ * The heat-up signature of the tip is the temperature rise of the cold tip at the full power: 'early' during sig_skip periods
+ * since the power was applied and 'rise' during next sig_window periods. The rise depends on the heater resistance
+ * and the thermal mass of the tip, the early rise depends on the distance between the heater and the sensor.
+ * The raw readings are used because the tip is unknown yet when the signature is checked.
+ * Returns the power to be applied: the full power while the signature is measured or the PID power p.
+ * The measurement is canceled if the tip is not cold or the temperature is close to the preset one
+ */
+int32_t IRON::measureSignature(int32_t t, int32_t p) {
+	uint16_t t_set = temp_low?temp_low:temp_set;
+	if (mode != POWER_ON || chill || (t + sig_margin >= t_set) || (sig_cnt == 1 && t >= iron_cold)) {
+		sig_cnt = 0;
+		return p;
+	}
+	if (sig_cnt == 1) {
+		sig_t0		= t;
+	} else if (sig_cnt == 1 + sig_skip) {
+		sig_early	= constrain(t - sig_t0, 0, 255);
+		sig_t0		= t;
+	} else if (sig_cnt == 1 + sig_skip + sig_window) {
+		sig_rise	= constrain(t - sig_t0, 0, 0xffff);
+		sig_ready	= true;
+		sig_cnt		= 0;
+		return p;
+	}
+	++sig_cnt;
+	return max_power;
+}
+
+bool IRON::heatSignature(uint16_t *rise, uint8_t *early) {
+	if (!sig_ready) return false;
+	sig_ready	= false;
+	*rise		= sig_rise;
+	*early		= sig_early;
+	return true;
+}
+
 void IRON::reset(void) {
 	resetShortTemp();
 	h_power.reset();
 	h_temp.reset();
 	d_power.reset();
 	d_temp.reset();
+	settle.reset();
+	approach.reset();
+	sig_cnt		= 0;
+	sig_ready	= false;
 	mode = POWER_OFF;										// New tip inserted, clear COOLING mode
 }
 
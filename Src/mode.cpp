@@ -5,10 +5,11 @@
  *      Author: Alex
  */
 
-#include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "mode.h"
 #include "tools.h"
+#include "telemetry.h"
 
 //---------------------- The Menu mode -------------------------------------------
 void MODE::setup(MODE* return_mode, MODE* short_mode, MODE* long_mode) {
@@ -18,14 +19,14 @@ void MODE::setup(MODE* return_mode, MODE* short_mode, MODE* long_mode) {
 }
 
 MODE* MODE::returnToMain(void) {
-	if (mode_return && time_to_return && HAL_GetTick() >= time_to_return)
+	if (mode_return && time_to_return.expired())
 		return mode_return;
 	return this;
 }
 
 void MODE::resetTimeout(void) {
 	if (timeout_secs) {
-		time_to_return = HAL_GetTick() + timeout_secs * 1000;
+		time_to_return.start(timeout_secs * 1000);
 	}
 }
 void MODE::setTimeout(uint16_t t) {
@@ -63,8 +64,8 @@ void MSTBY_IRON::init(void) {
 	}
 	no_handle		= false;								// By default the soldering IRON handle is connected
 	old_temp_set	= temp_setH;							// Save the rotary encoder position
-	update_screen	= 0;									// Force to redraw the screen
-	clear_used_ms 	= 0;
+	pCore->render.request();								// Force to redraw the screen
+	clear_used.cancel();
 	used = !pIron->isCold();								// The IRON is in COOLING mode
 }
 
@@ -91,7 +92,7 @@ MODE* MSTBY_IRON::loop(void) {
     	button = 0;
     	pEnc->write(old_temp_set);
     	pCore->scrsaver.reset();
-		update_screen = 0;
+		pCore->render.request();
 	}
 
     if (button == 1) {										// The button pressed shortly
@@ -104,21 +105,19 @@ MODE* MSTBY_IRON::loop(void) {
     if (temp_set_h != old_temp_set) {						// Preset temperature changed
     	old_temp_set = temp_set_h;
     	pCFG->savePresetTempHuman(temp_set_h);
-    	update_screen = 0;									// Force to redraw the screen
+    	pCore->render.request();							// Force to redraw the screen
     }
 
-    if (HAL_GetTick() < update_screen) return this;
-    update_screen = HAL_GetTick() + 1000;
+    if (!pCore->render.due(1000)) return this;
 
 	if (used && pIron->isCold()) {
     	pD->msgCold();
     	pCore->buzz.lowBeep();
-		clear_used_ms = HAL_GetTick() + 60000;
+		clear_used.start(60000);
 		used = false;
 	}
 
-	if (clear_used_ms && HAL_GetTick() >= clear_used_ms) {
-		clear_used_ms = 0;
+	if (clear_used.expired()) {
 		pD->msgOFF();
 	}
 
@@ -186,14 +185,15 @@ void MWORK_IRON::init(void) {
 	pD->mainInit();
 	pD->msgON();
 	pD->tip(pCFG->tipName());
-	idle_pwr.length(ec);
 	idle_pwr.reset();										// Initialize the history for power in idle state
 	auto_off_notified 	= false;
 	ready 				= false;
-	lowpower_time		= 0;								// Low power mode is not enabled yet
-	time_to_return		= 0;								// Do not allow to return to standby mode
+	lowpower_timer.cancel();								// Low power mode is not enabled yet
+	time_to_return.cancel();								// Do not allow to return to standby mode
 	old_temp_set 		= tempH;							// Save current rotary encoder position
-	update_screen		= 0;
+	tilt				= false;
+	hold_timer.start(hold_period, hold_period);
+	pCore->render.request();
 	pIron->switchPower(true);
 }
 
@@ -213,14 +213,10 @@ void MWORK_IRON::adjustPresetTemp(void) {
 bool MWORK_IRON::hwTimeout(bool tilt_active) {
 	CFG*	pCFG	= &pCore->cfg;
 
-	uint32_t now_ms = HAL_GetTick();
-	if (lowpower_time == 0 || tilt_active) {				// If the IRON is used, reset standby time
-		lowpower_time = now_ms + pCFG->getLowTO() * 5000;	// Convert timeout (5 secs interval) to milliseconds
+	if (!lowpower_timer.isActive() || tilt_active) {		// If the IRON is used, reset standby time
+		lowpower_timer.start(pCFG->getLowTO() * 5000);		// Convert timeout (5 secs interval) to milliseconds
 	}
-	if (now_ms >= lowpower_time) {
-		return true;
-	}
-	return false;
+	return lowpower_timer.isFired();
 }
 
 // Use applied power analysis to automatically power-off the IRON
@@ -236,13 +232,13 @@ void MWORK_IRON::swTimeout(uint16_t temp, uint16_t temp_set, uint16_t temp_setH,
 
 	// Check the IRON current status: idle or used
 	if (abs(ap - ip) >= 150) {						// The applied power is different than idle power. The IRON being used!
-		time_to_return 		= HAL_GetTick() + pCFG->getOffTimeout() * 60000;
+		time_to_return.start(pCFG->getOffTimeout() * 60000);
 		auto_off_notified 	= false;				// Initialize the idle state power
 		pD->msgON();
 	} else {										// The IRON is in its idle state
-		if (time_to_return == 0)
-			time_to_return 	= HAL_GetTick() + pCFG->getOffTimeout() * 60000;
-		uint32_t to = (time_to_return - HAL_GetTick()) / 1000;
+		if (!time_to_return.isActive())
+			time_to_return.start(pCFG->getOffTimeout() * 60000);
+		uint32_t to = time_to_return.remaining() / 1000;
 		if (to < 100) {
 			pD->timeToOff(to);						// Show the time remaining to switch off the IRON
 			if (!auto_off_notified) {
@@ -269,13 +265,16 @@ MODE* MWORK_IRON::loop(void) {
 		gun_work->keepIronWorking(pCFG->isKeepIron());		// Keep IRON working if enabled
     	return gun_work;
 	}
+	// The tip has been pulled out, the standby mode activates the Tip selection mode
+    if (!pIron->noAmbientSensor() && !pIron->isConnected() && isACsine())
+    	return mode_return;
 
     // In the Screen saver mode, any rotary encoder change should be ignored
     if ((button > 0 || temp_set_h != old_temp_set) && pCore->scrsaver.scrSaver()) {
     	button = 0;
     	pEnc->write(old_temp_set);
     	pCore->scrsaver.reset();
-		update_screen = 0;
+		pCore->render.request();
 	}
 
     if (button == 1) {										// The button pressed
@@ -287,13 +286,18 @@ MODE* MWORK_IRON::loop(void) {
     	}
     }
 
+	uint16_t	sig_rise;
+	uint8_t		sig_early;
+	if (pIron->heatSignature(&sig_rise, &sig_early) && pCFG->isTipCalibrated())
+		pCore->usage.heatSignature(sig_rise, sig_early);	// The cold tip heated up, update its signature
+
 	int16_t ambient	= pIron->ambientTemp();
 	if (temp_set_h != old_temp_set) {						// Encoder rotated, new preset temperature entered
 		old_temp_set 		= temp_set_h;
 		ready 				= false;
-		time_to_return 		= 0;							// Disable auto-off timeout
+		time_to_return.cancel();							// Disable auto-off timeout
 		auto_off_notified 	= false;
-		update_screen		= 0;							// Update display
+		pCore->render.request();							// Update display
 		uint16_t temp = pCFG->humanToTemp(temp_set_h, ambient); // Translate human readable temperature into internal value
 		pIron->setTemp(temp);
 		pCFG->savePresetTempHuman(temp_set_h);				// Update the information in memory only, do not change the EEPROM
@@ -301,8 +305,17 @@ MODE* MWORK_IRON::loop(void) {
 		pCore->scrsaver.reset();
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-    update_screen = HAL_GetTick() + period;
+	// Track the holding power of the idle tip in the steady state to estimate the tip wear
+	if (hold_timer.expired() && ready && !ready_clear.isActive() && !tilt
+			&& pIron->isSettled(ready_tolerance, ready_confidence)) {
+		int ap = pIron->avgPower();
+		if (ap > 0) {
+			int16_t delta = pCFG->tempCelsius(pIron->averageTemp(), ambient, DEV_IRON) - ambient;
+			pCore->usage.holdPower(ap, delta);
+		}
+	}
+
+	if (!pCore->render.due(period)) return this;
 
     int temp			= pIron->averageTemp();
 	int temp_set		= pIron->presetTemp();				// Now the preset temperature in internal units!!!
@@ -320,13 +333,14 @@ MODE* MWORK_IRON::loop(void) {
 	bool tilt_active = false;
 	if (low_power_enabled)									// If low power mode enabled, check tilt switch status
 		tilt_active = pIron->isReedSwitch(pCFG->isReedType());	// True if iron was used
+	tilt = tilt_active;
 
 
 	// Check the IRON reaches the preset temperature
-	if ((abs(temp_set - temp) < 6) && (td <= 500) && (ap > 0))  {
+	if (pIron->isSettled(ready_tolerance, ready_confidence) && (ap > 0))  {
 	    if (!ready) {
 	    	ready = true;
-	    	ready_clear	= HAL_GetTick() + 2000;
+	    	ready_clear.start(2000);
 	    	pD->msgReady();
 	    	pCore->buzz.shortBeep();
 	    	if (!pCore->scrsaver.scrSaver())
@@ -336,7 +350,7 @@ MODE* MWORK_IRON::loop(void) {
 	}
 
 	// If the low power mode is enabled, check the IRON status
-	if (ready && ready_clear == 0) {						// The IRON has reaches the preset temperature and 'Ready' message is already cleared
+	if (ready && !ready_clear.isActive()) {						// The IRON has reaches the preset temperature and 'Ready' message is already cleared
 		if (low_power_enabled) {							// Use hardware tilt switch if low power mode enabled
 			if (hwTimeout(tilt_active)) {
 				if (low_power_mode) return low_power_mode;	// Switch to low power mode
@@ -348,8 +362,7 @@ MODE* MWORK_IRON::loop(void) {
 
 	adjustPresetTemp();
 
-	if (ready && ready_clear > 0 && HAL_GetTick() >= ready_clear) {
-		ready_clear = 0;
+	if (ready && ready_clear.expired()) {
 		pD->msgON();
 	}
 
@@ -377,7 +390,7 @@ void MLOW_POWER::init(void) {
 	pIron->lowPowerMode(temp);								// Activate low power mode
 	auto_off_notified 	= false;
 	pD->msgStandby();
-	update_screen		= 0;
+	pCore->render.request();
 	pCore->buzz.lowBeep();
 }
 
@@ -403,8 +416,7 @@ MODE* MLOW_POWER::loop(void) {
 		}
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-    update_screen = HAL_GetTick() + period;
+	if (!pCore->render.due(period)) return this;
 
     int16_t ambient		= pIron->ambientTemp();
     uint16_t temp		= pIron->averageTemp();
@@ -416,8 +428,8 @@ MODE* MLOW_POWER::loop(void) {
 		gun_temp = pCFG->tempToHuman(gun_temp, ambient, DEV_GUN);
 
 	// If the automatic power-off feature is enabled, check the IRON status
-	if (time_to_return) {									// Show the time remaining to switch off the IRON
-		uint32_t to = (time_to_return - HAL_GetTick()) / 1000;
+	if (time_to_return.isActive()) {						// Show the time remaining to switch off the IRON
+		uint32_t to = time_to_return.remaining() / 1000;
 		if (to < 100) {
 			pD->timeToOff(to);
 			if (!auto_off_notified) {
@@ -454,11 +466,11 @@ void MBOOST::init(void) {
 	pIron->setTemp(temp_set);
 	uint32_t duration	= pCFG->boostDuration();			// Boost duration time (sec)
 	pIron->fixPower(0xffff);								// Apply maximum value of fixed power, first phase
-	time_to_return		= HAL_GetTick() + duration * 1000;
+	time_to_return.start(duration * 1000);
 	pEnc->reset(0, 0, 1, 1, 1, false);
 	pCore->buzz.shortBeep();
 	old_pos				= 0;
-	update_screen		= 0;
+	pCore->render.request();
 	phase				= 0;								// Start first phase: heating supplying fixed amount of power
 }
 
@@ -491,8 +503,7 @@ MODE* MBOOST::loop(void) {
     	}
     }
 
-	if (HAL_GetTick() < update_screen) 	return this;
-    update_screen = HAL_GetTick() + 500;
+	if (!pCore->render.due(500)) return this;
 
     uint16_t ambient= pIron->ambientTemp();
     int temp		= pIron->averageTemp();
@@ -527,9 +538,18 @@ void MSLCT::init(void) {;
 	pEnc->reset(closest, 0, list_len-1, 1, 1, false);
 	tip_begin_select = HAL_GetTick();						// We stared the tip selection procedure
 	old_index		= 3;
-	update_screen	= 0;									// Force to redraw the screen
+	phase			= SLCT_WAIT;
+	shown_tip		= 0;
+	chosen			= false;
+	confirm_timer.cancel();
+	pCore->render.request();								// Force to redraw the screen
 }
 
+/*
+ * When the new tip is inserted and the operator has not chosen the tip, the cold tip is heated for a short time
+ * to measure its heat-up signature. The tip with the closest signature is shown in the list and selected after
+ * confirm_timeout unless the operator chooses another one. The confirmed signature refines the tip signature
+ */
 MODE* MSLCT::loop(void) {
 	DSPL*	pD		= &pCore->dspl;
 	CFG*	pCFG	= &pCore->cfg;
@@ -539,7 +559,9 @@ MODE* MSLCT::loop(void) {
 	uint8_t	 index 		= pEnc->read();
 	if (index != old_index) {
 		tip_begin_select 	= 0;
-		update_screen 		= 0;
+		if (phase == SLCT_CONFIRM)
+			confirm_timer.start(confirm_timeout);			// The operator is choosing another tip
+		pCore->render.request();
 	}
 	uint8_t	button = pEnc->buttonStatus();
 
@@ -547,23 +569,68 @@ MODE* MSLCT::loop(void) {
     	return mode_return;
     }
 
-	if (pIron->isConnected() || !isACsine()) {				// See core.cpp for isACsine()
+	if (phase != SLCT_WAIT && !pIron->isConnected() && isACsine()) {	// The tip was pulled out again
+		pIron->switchPower(false);
+		phase = SLCT_WAIT;
+		pCore->render.request();
+	}
+
+	if (phase == SLCT_HEAT) {
+		if (button > 0) {									// The operator does not wait for the tip identification
+			pIron->switchPower(false);
+			if (button == 2) return mode_lpress;
+			return selectTip(tip_list[index].tip_index);
+		}
+		if (pIron->heatSignature(&sig_rise, &sig_early)) {
+			pIron->switchPower(false);
+			int16_t tip_index = pCore->usage.identify(pCFG, sig_rise, sig_early);
+			if (tip_index < 0)								// No tip has the similar signature
+				return selectTip(tip_list[index].tip_index);
+			preselect(tip_index);
+			phase = SLCT_CONFIRM;
+			confirm_timer.start(confirm_timeout);
+			pCore->buzz.shortBeep();
+		} else if (!pIron->isSignatureBusy()) {				// The tip is not cold, the signature cannot be measured
+			pIron->switchPower(false);
+			return selectTip(tip_list[index].tip_index);
+		}
+		if (pCore->render.due(20000))
+			pD->tipListShow("Identifying...", tip_list, 3, tip_list[index].tip_index, true);
+		return this;
+	}
+
+	if (phase == SLCT_CONFIRM) {
+		if (button == 1) {									// The tip confirmed, so its signature is correct
+			MODE* next = selectTip(tip_list[index].tip_index);
+			pCore->usage.update(pCFG, false);				// Switch the usage statistics to the selected tip
+			if (pCFG->isTipCalibrated())
+				pCore->usage.heatSignature(sig_rise, sig_early);
+			return next;
+		}
+		if (confirm_timer.expired())
+			return selectTip(tip_list[index].tip_index);
+	} else if (pIron->isConnected() || !isACsine()) {		// See core.cpp for isACsine()
 		// Prevent bouncing event, when the IRON connection restored back too quickly.
 		if (tip_begin_select && (HAL_GetTick() - tip_begin_select) < 1000) {
 			return 0;
 		}
-		uint8_t tip_index = tip_list[index].tip_index;
-		pCFG->changeTip(tip_index);
-		pIron->reset();										// Clear temperature history and switch iron mode to "power off"
-		return mode_return;
+		if (!chosen && pIron->isConnected() && pCore->usage.canIdentify(pCFG)) {
+			pIron->reset();
+			int16_t ambient = pIron->ambientTemp();
+			pIron->setTemp(pCFG->humanToTemp(pCFG->tempPresetHuman(), ambient));
+			pIron->switchPower(true);						// Heat the tip at the full power, see IRON::heatSignature()
+			phase = SLCT_HEAT;
+			pCore->render.request();
+			return this;
+		}
+		return selectTip(tip_list[index].tip_index);
 	}
 
     if (button == 2) {										// The button was pressed for a long time
 	    return mode_lpress;
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 20000;
+	if (!pCore->render.due(20000)) return this;
 
 	for (int8_t i = index; i >= 0; --i) {
 		if (tip_list[(uint8_t)i].name[0]) {
@@ -573,6 +640,9 @@ MODE* MSLCT::loop(void) {
 	}
 	old_index = index;
 	uint8_t tip_index = tip_list[index].tip_index;
+	if (shown_tip && tip_index != shown_tip)
+		chosen = true;
+	shown_tip = tip_index;
 	for (uint8_t i = 0; i < 3; ++i)
 		tip_list[i].name[0] = '\0';
 	uint8_t list_len = pCFG->tipList(tip_index, tip_list, 3, true);
@@ -584,10 +654,28 @@ MODE* MSLCT::loop(void) {
 			pEnc->write(i);
 		}
 	}
-	pD->tipListShow("Select tip",  tip_list, 3, tip_index, true);
+	pD->tipListShow((phase == SLCT_CONFIRM)?"Confirm tip":"Select tip",  tip_list, 3, tip_index, true);
 	return this;
 }
 
+MODE* MSLCT::selectTip(uint8_t tip_index) {
+	pCore->cfg.changeTip(tip_index);
+	pCore->iron.reset();									// Clear temperature history and switch iron mode to "power off"
+	return mode_return;
+}
+
+void MSLCT::preselect(uint8_t tip_index) {
+	uint8_t list_len = pCore->cfg.tipList(tip_index, tip_list, 3, true);
+	for (uint8_t i = 0; i < list_len; ++i) {
+		if (tip_list[i].tip_index == tip_index) {
+			pCore->encoder.write(i);
+			old_index = i;
+		}
+	}
+	shown_tip = tip_index;
+	pCore->render.request();
+}
+
 //---------------------- The Activate tip mode: select tips to use ---------------
 void MTACT::init(void) {
 	CFG*	pCFG	= &pCore->cfg;
@@ -596,7 +684,7 @@ void MTACT::init(void) {
 	uint8_t tip_index = pCFG->currentTipIndex();
 	pEnc->reset(tip_index, 1, pCFG->TIPS::loaded()-1, 1, 1, false);	// Start from tip #1, because 0-th 'tip' is a Hot Air Gun
 	old_tip_index = 255;
-	update_screen = 0;
+	pCore->render.request();
 }
 
 MODE* MTACT::loop(void) {
@@ -612,21 +700,20 @@ MODE* MTACT::loop(void) {
 			pD->errorMessage("EEPROM\nwrite\nerror");
 			return 0;
 		}
-		update_screen = 0;									// Force redraw the screen
+		pCore->render.request();							// Force redraw the screen
 	} else if (button == 2) {
 		return mode_lpress;
 	}
 
 	if (tip_index != old_tip_index) {
 		old_tip_index = tip_index;
-		update_screen = 0;
+		pCore->render.request();
 	}
 
-	if (HAL_GetTick() >= update_screen) {
+	if (pCore->render.due(60000)) {
 		TIP_ITEM	tip_list[3];
 		uint8_t loaded = pCFG->tipList(tip_index, tip_list, 3, false);
 		pD->tipListShow("Activate tip",  tip_list, loaded, tip_index, false);
-		update_screen = HAL_GetTick() + 60000;
 	}
 	return this;
 }
@@ -661,7 +748,7 @@ void MMENU::init(void) {
 	if (!pCFG->isTipCalibrated())
 		mode_menu_item	= tip_calib_menu;						// Index of 'calibrate tip' menu item
 	pEnc->reset(mode_menu_item, 0, M_MENU_LENGTH-1, 1, 1, true);
-	update_screen = 0;
+	pCore->render.request();
 }
 
 MODE* MMENU::loop(void) {
@@ -703,7 +790,7 @@ MODE* MMENU::loop(void) {
 			default:
 				break;
 		}
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	}
 
 	// Going through the main menu
@@ -811,10 +898,9 @@ MODE* MMENU::loop(void) {
 	}
 
 	if (button > 0) {											// Either short or long press
-		update_screen 	= 0;									// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	}
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 10000;
+	if (!pCore->render.due(10000)) return this;
 
 	// Build current menu item value
 	char item_value[10];
@@ -827,65 +913,66 @@ MODE* MMENU::loop(void) {
 			break;
 		case 2:													// Buzzer setup
 			if (buzzer)
-				sprintf(item_value, "ON");
+				strcpy(item_value, "ON");
 			else
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			break;
 		case 3:													// Keep iron working while in Hot Air Gun Mode
 			if (keep_iron)
-				sprintf(item_value, "KEEP");
+				strcpy(item_value, "KEEP");
 			else
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			break;
 		case 4:													// TILT/REED
 			if (reed)
-				sprintf(item_value, "REED");
+				strcpy(item_value, "REED");
 			else
-				sprintf(item_value, "TILT");
+				strcpy(item_value, "TILT");
 			break;
 		case 5:													// Preset temperature step (1/5)
-			sprintf(item_value, "%1d deg.", temp_step?5:1);
+			fmtStr(fmtInt(item_value, temp_step?5:1), " deg.");
 			break;
 		case 6:													// Auto start ON/OFF
-			sprintf(item_value, auto_start?"ON":"OFF");
+			strcpy(item_value, auto_start?"ON":"OFF");
 			break;
 		case 7:													// auto off timeout
 			if (off_timeout) {
-				sprintf(item_value, "%2d min", off_timeout);
+				fmtStr(fmtInt(item_value, off_timeout, 2), " min");
 			} else {
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			}
 			break;
 		case 8:													// Standby temperature
 			if (low_temp) {
 				if (celsius) {
-					sprintf(item_value, "%3d C", low_temp);
+					fmtStr(fmtInt(item_value, low_temp, 3), " C");
 				} else {
-					sprintf(item_value, "%3d F", celsiusToFahrenheit(low_temp));
+					fmtStr(fmtInt(item_value, celsiusToFahrenheit(low_temp), 3), " F");
 				}
 			} else {
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			}
 			break;
 		case 9:													// Standby timeout (5 secs intervals)
 			if (low_temp) {
 				uint16_t to = (uint16_t)low_to * 5;				// Timeout in seconds
 				if (to < 60) {
-					sprintf(item_value, "%2d sec", to);
+					fmtStr(fmtInt(item_value, to, 2), " sec");
 				} else if (to %60) {
-					sprintf(item_value, "%2dm %2ds", to/60, to % 60);
+					char *p = fmtStr(fmtInt(item_value, to/60, 2), "m ");
+					fmtStr(fmtInt(p, to % 60, 2), "s");
 				} else {
-					sprintf(item_value, "%2d min", to/60);
+					fmtStr(fmtInt(item_value, to/60, 2), " min");
 				}
 			} else {
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			}
 			break;
 		case 10:
 			if (scr_saver) {
-				sprintf(item_value, "%2d min", scr_saver);
+				fmtStr(fmtInt(item_value, scr_saver, 2), " min");
 			} else {
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			}
 			break;
 		default:
@@ -906,7 +993,7 @@ void MCALMENU::init(void) {
 	RENC*	pEnc	= &pCore->encoder;
 	pEnc->reset(0, 0, 3, 1, 1, true);
 	old_item		= 4;
-	update_screen	= 0;
+	pCore->render.request();
 }
 
 MODE* MCALMENU::loop(void) {
@@ -918,19 +1005,16 @@ MODE* MCALMENU::loop(void) {
 	uint8_t button	= pEnc->buttonStatus();
 
 	if (button == 1) {
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	} else if (button == 2) {									// The button was pressed for a long time
 	   	return mode_lpress;
 	}
 
 	if (old_item != item) {
 		old_item = item;
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 10000;
-
 	if (button == 1) {											// The button was pressed
 		switch (item) {
 			case 0:												// Calibrate tip automatically
@@ -947,6 +1031,8 @@ MODE* MCALMENU::loop(void) {
 		}
 	}
 
+	if (!pCore->render.due(10000)) return this;
+
 	pD->menuItemShow("Calibrate", menu_list[item], 0, false);
 	return this;
 }
@@ -979,65 +1065,59 @@ void MCALIB::init(void) {
 	ref_temp_index 	= 0;
 	ready			= false;
 	tuning			= false;
+	refine			= false;
 	old_encoder 	= 3;
-	update_screen 	= 0;
+	pCore->render.request();
 	tip_temp_max 	= int_temp_max / 2;							// The maximum possible temperature defined in iron.h
 }
 
 /*
- * Calculate tip calibration parameter using linear approximation by Ordinary Least Squares method
- * Y = a * X + b, where
- * Y - internal temperature, X - real temperature. a and b are double coefficients
- * a = (N * sum(Xi*Yi) - sum(Xi) * sum(Yi)) / ( N * sum(Xi^2) - (sum(Xi))^2)
- * b = 1/N * (sum(Yi) - a * sum(Xi))
+ * Calculate tip calibration parameters by the Least Squares method: Y = P(X), where
+ * Y - internal temperature, X - real temperature, P - polynomial of degree up to 3.
+ * The thermocouple response is not linear, so the more points entered the higher degree of the polynomial is used:
+ * 3-4 points - line, 5 points - quadratic, 6 points and more - cubic.
+ * The fitted curve is saved as its values in the reference points of the tip: the polynomial of degree up to 3
+ * is restored from the four points (see TIP_CFG::curveTemp()), the tip is saved with TIP_CURVE flag.
+ * If the curve is not monotonic between the reference points, the lower degree polynomial is used.
+ * Returns the degree of the polynomial or 0 if the calibration cannot be built
  */
-bool MCALIB::calibrationOLS(uint16_t* tip, uint16_t min_temp, uint16_t max_temp) {
-	long sum_XY = 0;											// sum(Xi * Yi)
-	long sum_X 	= 0;											// sum(Xi)
-	long sum_Y  = 0;											// sum(Yi)
-	long sum_X2 = 0;											// sum(Xi^2)
-	long N		= 0;
-
+uint8_t MCALIB::calibrationOLS(uint16_t* tip, uint16_t min_temp, uint16_t max_temp) {
+	uint16_t	X[MCALIB_POINTS], Y[MCALIB_POINTS];
+	uint8_t		N = 0;
 	for (uint8_t i = 0; i < MCALIB_POINTS; ++i) {
-		uint16_t X 	= calib_temp[0][i];
-		uint16_t Y	= calib_temp[1][i];
-		if (X >= min_temp && X <= max_temp) {
-			sum_XY 	+= X * Y;
-			sum_X	+= X;
-			sum_Y   += Y;
-			sum_X2  += X * X;
+		if (calib_temp[0][i] >= min_temp && calib_temp[0][i] <= max_temp) {
+			X[N]	= calib_temp[0][i];
+			Y[N]	= calib_temp[1][i];
 			++N;
 		}
 	}
 
 	if (N <= 2)													// Not enough real temperatures have been entered
-		return false;
-
-	double	a  = (double)N * (double)sum_XY - (double)sum_X * (double)sum_Y;
-			a /= (double)N * (double)sum_X2 - (double)sum_X * (double)sum_X;
-	double 	b  = (double)sum_Y - a * (double)sum_X;
-			b /= (double)N;
-
-	for (uint8_t i = 0; i < 4; ++i) {
-		double temp = a * (double)pCore->cfg.referenceTemp(i) + b;
-		tip[i] = round(temp);
-	}
-	if (tip[3] > int_temp_max) tip[3] = int_temp_max;			// Maximal possible temperature (main.h)
-	return true;
-}
+		return 0;
 
-// Find the index of the reference point with the closest temperature
-uint8_t MCALIB::closestIndex(uint16_t temp) {
-	uint16_t diff = 1000;
-	uint8_t index = MCALIB_POINTS;
-	for (uint8_t i = 0; i < MCALIB_POINTS; ++i) {
-		uint16_t X = calib_temp[0][i];
-		if (X > 0 && abs(X-temp) < diff) {
-			diff = abs(X-temp);
-			index = i;
+	uint8_t degree = 1;
+	if (N >= 6)
+		degree = 3;
+	else if (N == 5)
+		degree = 2;
+	POLYFIT	curve;
+	for ( ; degree > 0; --degree) {
+		if (!curve.fit(X, Y, N, degree)) continue;
+		bool monotonic = true;
+		for (uint8_t i = 0; i < 4; ++i) {
+			int32_t temp = curve.value(pCore->cfg.referenceTemp(i));
+			tip[i] = constrain(temp, 0, int_temp_max);			// Maximal possible temperature (main.h)
+			if (i > 0 && tip[i] <= tip[i-1]) monotonic = false;
+		}
+		int32_t prev = tip[0];
+		for (uint16_t t = pCore->cfg.referenceTemp(0) + 5; monotonic && t <= pCore->cfg.referenceTemp(3); t += 5) {
+			int32_t temp = curve.value(t);
+			if (temp <= prev) monotonic = false;
+			prev = temp;
 		}
+		if (monotonic) return degree;
 	}
-	return index;
+	return 0;
 }
 
 void MCALIB::updateReference(uint8_t indx) {					// Update reference points
@@ -1076,16 +1156,12 @@ void MCALIB::buildFinishCalibration(void) {
 	CFG* 	pCFG 	= &pCore->cfg;
 	IRON*	pIron	= &pCore->iron;
 	uint16_t tip[4];
-	if (calibrationOLS(tip, 150, pCFG->referenceTemp(2))) {
-		uint8_t near_index	= closestIndex(pCFG->referenceTemp(3));
-		tip[3] = map(pCFG->referenceTemp(3), pCFG->referenceTemp(2), calib_temp[0][near_index],
-				tip[2], calib_temp[1][near_index]);
-		if (tip[3] > int_temp_max) tip[3] = int_temp_max;		// Maximal possible temperature (main.h)
-
+	uint8_t degree = calibrationOLS(tip, 150, 600);
+	if (degree) {
 		uint8_t tip_index 	= pCFG->currentTipIndex();
 		int16_t ambient 	= pIron->ambientTemp();
-		pCFG->applyTipCalibtarion(tip, ambient);
-		pCFG->saveTipCalibtarion(tip_index, tip, TIP_ACTIVE | TIP_CALIBRATED, ambient);
+		pCFG->applyTipCalibtarion(tip, ambient, degree > 1);
+		pCFG->saveTipCalibtarion(tip_index, tip, TIP_ACTIVE | TIP_CALIBRATED | ((degree > 1)?TIP_CURVE:0), ambient);
 	}
 }
 
@@ -1100,52 +1176,37 @@ MODE* MCALIB::loop(void) {
 
     if (encoder != old_encoder) {
     	old_encoder = encoder;
-    	update_screen = 0;
+    	pCore->render.request();
     }
 
 	if (button == 1) {											// The button pressed
-		if (tuning) {											// New reference temperature was entered
-			pIron->switchPower(false);
+		if (refine) {											// Do not wait for the temperature to settle, keep the predicted one
+			refine = false;
+			acceptReference();
+		} else if (tuning) {									// New reference temperature was entered
 		    if (ready) {										// The temperature was stabilized and real data can be entered
 		    	ready = false;
 			    uint16_t temp	= pIron->averageTemp();			// The temperature of the IRON in internal units
+			    if (predicted) temp = predicted;				// The temperature is still approaching the predicted value
 			    uint16_t r_temp = encoder;						// The real temperature entered by the user
 			    if (!pCFG->isCelsius())							// Always save the human readable temperature in Celsius
 			    	r_temp = fahrenheitToCelsius(r_temp);
-			    uint8_t ref = ref_temp_index;
-			    calib_temp[0][ref] = r_temp;
-			    calib_temp[1][ref] = temp;
-			    if (r_temp < pCFG->tempMaxC() - 20) {
-			    	updateReference(ref_temp_index);			// Update reference points
-			    	++ref_temp_index;
-			    	// Try to update the current tip calibration
-			    	uint16_t tip[4];
-			    	 if (calibrationOLS(tip, 150, 600))
-			    		 pCFG->applyTipCalibtarion(tip, pIron->ambientTemp());
-			    } else {										// Finish calibration
-			    	ref_temp_index = MCALIB_POINTS;
+			    calib_temp[0][ref_temp_index] = r_temp;
+			    calib_temp[1][ref_temp_index] = temp;
+			    if (predicted) {								// Keep heating, the real temperature is asked again when settled
+			    	refine = true;
+			    	pCore->render.request();
+			    	return this;
 			    }
+			    acceptReference();
 		    } else {											// Stop heating, return from tuning mode
+		    	pIron->switchPower(false);
 		    	tuning = false;
-		    	update_screen = 0;
+		    	pCore->render.request();
 		    	return this;
 		    }
-		    tuning = false;
 		}
-		if (!tuning) {
-			if (ref_temp_index < MCALIB_POINTS) {
-				tuning = true;
-				uint16_t temp = calib_temp[1][ref_temp_index];
-				pIron->setTemp(temp);
-				pIron->switchPower(true);
-			} else {											// All reference points are entered
-				buildFinishCalibration();
-				PIDparam pp = pCFG->pidParams(use_iron);		// Restore default PID parameters
-				pIron->PID::load(pp);
-				return mode_lpress;
-			}
-		}
-		update_screen = 0;
+		return nextReference();
 	} else if (!tuning && button == 2) {						// The button was pressed for a long time, save tip calibration
 		buildFinishCalibration();
 		PIDparam pp = pCFG->pidParams(use_iron);				// Restore default PID parameters
@@ -1153,12 +1214,49 @@ MODE* MCALIB::loop(void) {
 	    return mode_lpress;
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 500;
+	if (refine) {
+		// The real temperature was read while the tip was still heating, ask it again when the temperature settles.
+		// The next button press saves the corrected real temperature against the settled one
+		if (pIron->isSettled(settle_tolerance, settle_confidence)) {
+			int16_t	ambient	= pIron->ambientTemp();
+			refine		= false;
+			predicted	= 0;
+			ready		= true;
+			pCore->buzz.shortBeep();
+			pEnc->write(pCFG->tempToHuman(pIron->averageTemp(), ambient));
+			pCore->render.request();
+		}
+	} else if (tuning && !ready && pIron->avgPowerPcnt() > 1) {
+		int32_t		final;
+		uint16_t	bound;
+		uint16_t	sample = pIron->approachSamples();
+		if (pIron->isSettled(settle_tolerance, settle_confidence)) {
+			predicted	= 0;
+			ready		= true;
+		} else if (sample != last_sample) {					// The prediction can change on the new approach sample only
+			last_sample = sample;
+			if (pIron->predictTemp(&final, &bound) && bound <= settle_tolerance &&
+					(confirmed == 0 || abs(final - predicted) <= settle_tolerance)) {
+				if (confirmed == 0) predicted = final;			// The predictions should agree on several samples in a row
+				ready = (++confirmed >= predict_confirm);
+			} else {
+				predicted	= 0;
+				confirmed	= 0;
+			}
+		}
+		if (ready) {
+			int16_t	ambient	= pIron->ambientTemp();
+			uint16_t temp	= predicted?predicted:pIron->averageTemp();
+			pCore->buzz.shortBeep();
+			pEnc->write(pCFG->tempToHuman(temp, ambient));
+			pCore->render.request();
+		}
+	}
+
+	if (!pCore->render.due(500)) return this;
 
 	int16_t	 ambient	= pIron->ambientTemp();
 	uint16_t real_temp 	= encoder;
-	uint16_t temp_set	= pIron->presetTemp();
 	uint16_t temp 		= pIron->averageTemp();
 	uint8_t  power		= pIron->avgPowerPcnt();
 	uint16_t tempH 		= pCFG->tempToHuman(temp, ambient);
@@ -1170,14 +1268,6 @@ MODE* MCALIB::loop(void) {
 		return mode_lpress;
 	}
 
-	if (tuning && (abs(temp_set - temp) <= 16) && (pIron->pwrDispersion() <= 200) && power > 1)  {
-		if (!ready) {
-			pCore->buzz.shortBeep();
-			pEnc->write(tempH);
-			ready = true;
-	    }
-	}
-
 	uint8_t	int_temp_pcnt = 0;
 	if (temp >= start_int_temp)
 		int_temp_pcnt = map(temp, start_int_temp, int_temp_max, 0, 100);	// int_temp_max defined in vars.cpp
@@ -1185,6 +1275,47 @@ MODE* MCALIB::loop(void) {
 	return this;
 }
 
+// Save the entered reference point and update the tip calibration
+void MCALIB::acceptReference(void) {
+	CFG*	pCFG	= &pCore->cfg;
+	IRON*	pIron	= &pCore->iron;
+
+	pIron->switchPower(false);
+	if (calib_temp[0][ref_temp_index] < pCFG->tempMaxC() - 20) {
+		updateReference(ref_temp_index);						// Update reference points
+		++ref_temp_index;
+		// Try to update the current tip calibration
+		uint16_t tip[4];
+		uint8_t degree = calibrationOLS(tip, 150, 600);
+		if (degree)
+			pCFG->applyTipCalibtarion(tip, pIron->ambientTemp(), degree > 1);
+	} else {													// Finish calibration
+		ref_temp_index = MCALIB_POINTS;
+	}
+	tuning = false;
+}
+
+// Start heating to the next reference point or finish the calibration
+MODE* MCALIB::nextReference(void) {
+	CFG*	pCFG	= &pCore->cfg;
+	IRON*	pIron	= &pCore->iron;
+
+	if (ref_temp_index < MCALIB_POINTS) {
+		tuning		= true;
+		predicted	= 0;
+		confirmed	= 0;
+		last_sample	= pIron->approachSamples();
+		pIron->setTemp(calib_temp[1][ref_temp_index]);
+		pIron->switchPower(true);
+		pCore->render.request();
+		return this;
+	}
+	buildFinishCalibration();									// All reference points are entered
+	PIDparam pp = pCFG->pidParams(use_iron);					// Restore default PID parameters
+	pIron->PID::load(pp);
+	return mode_lpress;
+}
+
 //---------------------- The manual calibration tip mode -------------------------
 /*
  * Here the operator should 'guess' the internal temperature readings for desired temperature.
@@ -1207,9 +1338,9 @@ void MCALIB_MANUAL::init(void) {
 	ref_temp_index 		= 0;
 	ready				= false;
 	tuning				= false;
-	temp_setready_ms	= 0;
+	temp_setready.cancel();
 	old_encoder			= 4;
-	update_screen		= 0;
+	pCore->render.request();
 }
 
 /*
@@ -1270,9 +1401,9 @@ MODE* MCALIB_MANUAL::loop(void) {
     			pHG->setTemp(encoder);
     		}
     		ready = false;
-    		temp_setready_ms = HAL_GetTick() + 5000;    		// Prevent beep just right the new temperature setup
+    		temp_setready.start(5000);			    		// Prevent beep just right the new temperature setup
     	}
-    	update_screen = 0;
+    	pCore->render.request();
     }
 
 	int16_t ambient = pIron->ambientTemp();
@@ -1281,7 +1412,7 @@ MODE* MCALIB_MANUAL::loop(void) {
     		restorePIDconfig(pCFG, pIron, pHG);
     		return 0;
     	}
-	} else if (temp_setready_ms && (HAL_GetTick() > temp_setready_ms) && !pHG->isConnected()) {
+	} else if (temp_setready.isFired() && !pHG->isConnected()) {
 		restorePIDconfig(pCFG, pIron, pHG);
 		return 0;
 	}
@@ -1323,7 +1454,7 @@ MODE* MCALIB_MANUAL::loop(void) {
 				pHG->switchPower(true);
 			}
 		}
-		update_screen = 0;
+		pCore->render.request();
 	} else if (button == 2) {									// The button was pressed for a long time, save tip calibration
 		uint8_t tip_index = pCFG->currentTipIndex();			// IRON actual tip index
 		buildCalibration(ambient, calib_temp, 10); 				// 10 is bigger then the last index in the reference temp. Means build final calibration
@@ -1338,8 +1469,7 @@ MODE* MCALIB_MANUAL::loop(void) {
 		rt_index	= ref_temp_index;
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 500;
+	if (!pCore->render.due(500)) return this;
 
 	uint16_t temp_set		= 0;								// Prepare the parameters to be displayed
 	uint16_t temp			= 0;
@@ -1360,10 +1490,9 @@ MODE* MCALIB_MANUAL::loop(void) {
 		pwr_disp_max	= 40;
 	}
 	if (tuning && (abs(temp_set - temp) <= 16) && (pwr_disp <= pwr_disp_max) && power > 1)  {
-		if (!ready && temp_setready_ms && (HAL_GetTick() > temp_setready_ms)) {
+		if (!ready && temp_setready.expired()) {
 			pCore->buzz.shortBeep();
 			ready 				= true;
-			temp_setready_ms	= 0;
 	    }
 	}
 
@@ -1388,7 +1517,7 @@ void MMBST::init(void) {
 	mode		= 0;
 	pEnc->reset(0, 0, 2, 1, 1, true);							// Select the boot menu item
 	old_item	= 0;
-	update_screen = 0;
+	pCore->render.request();
 }
 
 MODE* MMBST::loop(void) {
@@ -1400,7 +1529,7 @@ MODE* MMBST::loop(void) {
 	uint8_t  button		= pEnc->buttonStatus();
 
 	if (button == 1) {
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	} else if (button == 2) {									// The button was pressed for a long time
 		// Save the boost parameters to the current configuration. Do not write it to the EEPROM!
 		pCFG->saveBoost(delta_temp, duration);
@@ -1417,12 +1546,9 @@ MODE* MMBST::loop(void) {
 				duration	= item;
 				break;
 		}
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 10000;
-
 	if (!mode) {												// The boost menu item selection mode
 		if (button == 1) {										// The button was pressed
 			switch (item) {
@@ -1453,6 +1579,8 @@ MODE* MMBST::loop(void) {
 		}
 	}
 
+	if (!pCore->render.due(10000)) return this;
+
 	// Show current menu item
 	char item_value[10];
 	item_value[1] = '\0';
@@ -1468,13 +1596,16 @@ MODE* MMBST::loop(void) {
 					delta_t = (delta_t * 9 + 3) / 5;
 					sym = 'F';
 				}
-				sprintf(item_value, "+%2d %c", delta_t, sym);
+				char *p = fmtInt(fmtStr(item_value, "+"), delta_t, 2);
+				*p++ = ' ';
+				*p++ = sym;
+				*p   = '\0';
 			} else {
-				sprintf(item_value, "OFF");
+				strcpy(item_value, "OFF");
 			}
 			break;
 		case 1:													// duration (secs)
-		    sprintf(item_value, "%3d s.", duration);
+		    fmtStr(fmtInt(item_value, duration, 3), " s.");
 			break;
 		default:
 			item_value[0] = '\0';
@@ -1492,12 +1623,12 @@ void MTUNE::init(void) {
 	uint16_t max_power = 0;
 	if (use_iron) {
 		max_power = pCore->iron.getMaxFixedPower();
-		check_delay	= 0;										// IRON connection can be checked any time
+		check_delay.start(0);									// IRON connection can be checked any time
 	} else {
 		HOTGUN*	pHG	= &pCore->hotgun;
 		max_power 	= pHG->getMaxFixedPower();
 		pHG->setFan(1500);										// Make sure the fan will be blowing well.
-		check_delay		= HAL_GetTick() + 2000;					// Wait 2 seconds before checking Hot Air Gun
+		check_delay.start(2000);								// Wait 2 seconds before checking Hot Air Gun
 	}
 	pEnc->reset(max_power/3, 0, max_power, 1, 5, false);
 	old_power		= 0;
@@ -1517,7 +1648,7 @@ MODE* MTUNE::loop(void) {
     uint8_t  button	= pEnc->buttonStatus();
 
     if (!check_connected) {
-    	check_connected = HAL_GetTick() >= check_delay;
+    	check_connected = check_delay.isFired();
     } else {
     	if (use_iron) {
     		if (!pIron->isConnected())
@@ -1531,7 +1662,7 @@ MODE* MTUNE::loop(void) {
 	if (button == 1) {											// The button pressed
 		powered = !powered;
 	    if (powered) pD->msgON(); else pD->msgOFF();
-	    update_screen = 0;
+	    pCore->render.request();
 	} else if (button == 2) {									// The button was pressed for a long time
 		pCore->buzz.shortBeep();
 		return mode_lpress;
@@ -1546,11 +1677,10 @@ MODE* MTUNE::loop(void) {
     		pHG->fixPower(power);
     	}
     	old_power = power;
-    	update_screen = 0;
+    	pCore->render.request();
     }
 
-    if (HAL_GetTick() < update_screen) return this;
-    update_screen = HAL_GetTick() + 500;
+    if (!pCore->render.due(500)) return this;
 
     uint16_t tune_temp = gun_temp_maxC;							// vars.cpp
     if (use_iron) tune_temp = iron_temp_maxC;
@@ -1580,13 +1710,13 @@ void MTPID::init(void) {
 	pCore->iron.setTemp(1200);									// Use 'middle' temperature
 	pCore->hotgun.setTemp(1200);
 	pCore->hotgun.setFan(1500);
-	data_update 		= 0;
+	data_update.start(0, 100);								// Read the sensors every 100 ms
 	data_index 			= 0;
 	modify				= false;
 	on					= false;
 	old_index			= 3;
-	temp_setready_ms	= 0;
-	update_screen 		= 0;
+	temp_setready.cancel();
+	pCore->render.request();
 }
 
 MODE* MTPID::loop(void) {
@@ -1602,14 +1732,13 @@ MODE* MTPID::loop(void) {
     if (use_iron) {
     	if (!pIron->isConnected())
     		return 0;
-	} else if (temp_setready_ms && (HAL_GetTick() > temp_setready_ms) && !pHG->isConnected())
+	} else if (temp_setready.isFired() && !pHG->isConnected())
 		return 0;
 
 	if(button || old_index != index)
-		update_screen = 0;
+		pCore->render.request();
 
-	if (HAL_GetTick() >= data_update) {
-		data_update = HAL_GetTick() + 100;
+	if (data_update.expired()) {
 		int16_t  temp = 0;
 		uint32_t disp = 0;
 		if (use_iron) {
@@ -1622,13 +1751,11 @@ MODE* MTPID::loop(void) {
 		pD->pidPutData(temp, disp);
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-
 	PID* pPID	= pHG;
 	if (use_iron) pPID	= pIron;							// Pointer to the PID class instance
 
+	// Handle the button before the screen update check, the display may postpone the frame
 	if (modify) {											// The Coefficient is selected, start to show the Graphs
-		update_screen = HAL_GetTick() + 100;
 		if (button == 1) {									// Short button press: select another PID coefficient
 			modify = false;
 			pEnc->reset(data_index, 0, 2, 1, 1, true);
@@ -1642,7 +1769,26 @@ MODE* MTPID::loop(void) {
 			if (on) pD->pidInit();							// Reset display graph history
 			pCore->buzz.shortBeep();
 		}
+	} else {												// Selecting the PID coefficient to be tuned
+		if (button == 1) {									// Short button press: select another PID coefficient
+			modify = true;
+			data_index  = index;
+			// Prepare to change the coefficient [index]
+			uint16_t k = 0;
+			k = pPID->changePID(index+1, -1);				// Read the PID coefficient from the IRON or Hot Air Gun
+			pEnc->reset(k, 0, 20000, 1, 10, false);
+			return this;									// Restart the procedure
+		} else if (button == 2) {							// Long button press: save the parameters and return to menu
+			PIDparam pp = pPID->dump();
+			pCFG->savePID(pp, use_iron);
+			pCore->buzz.shortBeep();
+			return mode_lpress;
+		}
+	}
+
+	if (!pCore->render.due(modify?100:1000)) return this;	// Show the graph more often
 
+	if (modify) {
 		if (old_index != index) {
 			old_index = index;
 			pPID->changePID(data_index+1, index);
@@ -1654,29 +1800,12 @@ MODE* MTPID::loop(void) {
 		else
 			pwr_pcnt = pHG->avgPowerPcnt();
 		pD->pidShowGraph(pwr_pcnt);
-	} else {												// Selecting the PID coefficient to be tuned
-		update_screen = HAL_GetTick() + 1000;
-
+	} else {
 		if (old_index != index) {
 			old_index = index;
 			data_index  = index;
 		}
 
-		if (button == 1) {									// Short button press: select another PID coefficient
-			modify = true;
-			data_index  = index;
-			// Prepare to change the coefficient [index]
-			uint16_t k = 0;
-			k = pPID->changePID(index+1, -1);				// Read the PID coefficient from the IRON or Hot Air Gun
-			pEnc->reset(k, 0, 20000, 1, 10, false);
-			return this;									// Restart the procedure
-		} else if (button == 2) {							// Long button press: save the parameters and return to menu
-			PIDparam pp = pPID->dump();
-			pCFG->savePID(pp, use_iron);
-			pCore->buzz.shortBeep();
-			return mode_lpress;
-		}
-
 		uint16_t pid_k[3];
 		for (uint8_t i = 0; i < 3; ++i) {
 			pid_k[i] = 	pPID->changePID(i+1, -1);
@@ -1693,9 +1822,8 @@ void MWORK_GUN::init(void) {
 	HOTGUN*	pHG		= &pCore->hotgun;
 
 	edit_temp			= true;
-	return_to_temp		= 0;
 	ready				= false;
-	ready_clear			= 0;
+	ready_clear.cancel();
 	pCFG->activateGun(true);								// Load the Hot Air Gun calibration data (like another tip)
 	pD->mainInit();
 	uint16_t	fan		= pCFG->gunFanPreset();
@@ -1712,9 +1840,9 @@ void MWORK_GUN::init(void) {
 		pCore->iron.switchPower(true);
 	}
 	old_param		= 0;
-	update_screen	= 0;									// Force to redraw the screen
-	return_to_temp	= 1;									// Initialize Hot Air Gun configuration at the main loop
-	fan_animate		= 1;									// Do spin the fan icon
+	pCore->render.request();								// Force to redraw the screen
+	return_to_temp.start(0);								// Initialize Hot Air Gun configuration at the main loop
+	fan_animate.start(0);									// Do spin the fan icon
 	fan_angle		= 0;
 	SCRSAVER::init(pCFG->getScrTo());
 }
@@ -1728,7 +1856,7 @@ MODE* MWORK_GUN::loop(void) {
     int16_t	 ambient 	= pCore->iron.ambientTemp();
 
     // The fan speed modification mode has 'return_to_temp' timeout
-	if (return_to_temp && HAL_GetTick() >= return_to_temp) {// This reads the Hot Air Gun configuration Also
+	if (return_to_temp.expired()) {							// This reads the Hot Air Gun configuration Also
 		bool celsius 		= pCFG->isCelsius();
 		uint16_t temp_setH	= pCFG->gunTempPreset();
 		uint16_t t_min		= pCFG->tempMinC();				// The minimum preset temperature, defined in iron.h
@@ -1745,7 +1873,6 @@ MODE* MWORK_GUN::loop(void) {
 			pEnc->reset(temp_setH, t_min, t_max, 1, 1, false);
 		}
 		edit_temp		= true;
-		return_to_temp	= 0;
 		old_param		= temp_setH;
 	}
 
@@ -1767,7 +1894,7 @@ MODE* MWORK_GUN::loop(void) {
     	button = 0;
     	pEnc->write(old_param);
 		SCRSAVER::reset();
-		update_screen = 0;
+		pCore->render.request();
     }
 
     if (pCFG->isKeepIron() && button == 2) {				// Manage soldering iron if keep_iron is enabled
@@ -1780,16 +1907,16 @@ MODE* MWORK_GUN::loop(void) {
     	}
     	keep_iron = !keep_iron;
     } else if (button) {									// The button was pressed, toggle temp/fan
-    	update_screen = 0;
+    	pCore->render.request();
     	if (edit_temp) {									// Switch to edit fan speed
     		uint16_t fan = pHG->presetFan();
     		uint16_t max = pHG->maxFanSpeed();
     		pEnc->reset(fan, 0, max, 5, 10, false);
     		edit_temp 		= false;
     		old_param		= fan;
-    		return_to_temp	= HAL_GetTick() + edit_fan_timeout;
+    		return_to_temp.start(edit_fan_timeout);
     	} else {
-    		return_to_temp	= HAL_GetTick();				// Force to return to edit temperature
+    		return_to_temp.start(0);						// Force to return to edit temperature
     		return this;
     	}
     }
@@ -1806,24 +1933,23 @@ MODE* MWORK_GUN::loop(void) {
     		f = param;
     		pHG->setFan(f);
     		pD->fanSpeed(pHG->presetFanPcnt());
-    		return_to_temp	= HAL_GetTick() + edit_fan_timeout;
+    		return_to_temp.start(edit_fan_timeout);
     	}
     	uint16_t temp_setH	= pCFG->tempToHuman(t, ambient);
     	pCFG->saveGunPreset(temp_setH, f);
-    	update_screen 	= 0;								// Force to redraw the screen
+    	pCore->render.request();							// Force to redraw the screen
     	scr_saver_reset	= true;
     }
     if (scr_saver_reset) SCRSAVER::reset();
 
-	if (fan_animate && HAL_GetTick() >= fan_animate && pHG->isConnected()) {
+	if (fan_animate.isFired() && pHG->isConnected() && !pCore->render.adcWindow()) {
 		pD->animateFan(fan_angle);
 		++fan_angle;
 		fan_angle &= 0x3;
-		fan_animate = HAL_GetTick() + 100;
+		fan_animate.start(100);
 	}
 
-    if (HAL_GetTick() < update_screen) return this;
-    update_screen = HAL_GetTick() + 500;
+    if (!pCore->render.due(500)) return this;
 
     int16_t  temp_set	= pHG->presetTemp();
     int16_t  temp 		= pHG->averageTemp();
@@ -1832,14 +1958,13 @@ MODE* MWORK_GUN::loop(void) {
 
     if (!ready && (abs(temp_set - temp) < 50) && (pd <= 7) && (pwr > 0)) {
     	ready = true;
-    	ready_clear	= HAL_GetTick() + 5000;
+    	ready_clear.start(5000);
     	pCore->buzz.shortBeep();
     	pD->msgReady();
     }
 
-    if (ready_clear && HAL_GetTick() >= ready_clear) {
+    if (ready_clear.expired()) {
     	pD->msgON();
-    	ready_clear	= 0;
     }
     uint16_t temp_setH	= pCFG->gunTempPreset();
     uint16_t tempH		= pCFG->tempToHuman(temp, ambient);
@@ -1865,7 +1990,7 @@ MENU_GUN::MENU_GUN(HW* pCore, MODE* calib, MODE* pot_tune, MODE* pid_tune) : MOD
 void MENU_GUN::init(void) {
 	pCore->encoder.reset(0, 0, 4, 1, 1, true);
 	old_item		= 5;
-	update_screen	= 0;
+	pCore->render.request();
 }
 
 MODE* MENU_GUN::loop(void) {
@@ -1877,19 +2002,16 @@ MODE* MENU_GUN::loop(void) {
 	uint8_t button	= pEnc->buttonStatus();
 
 	if (button == 1) {
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	} else if (button == 2) {									// The button was pressed for a long time
 	   	return mode_lpress;
 	}
 
 	if (old_item != item) {
 		old_item = item;
-		update_screen = 0;										// Force to redraw the screen
+		pCore->render.request();								// Force to redraw the screen
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 10000;
-
 	if (button == 1) {											// The button was pressed
 		switch (item) {
 			case 0:												// Calibrate Hot Air Gun
@@ -1918,6 +2040,8 @@ MODE* MENU_GUN::loop(void) {
 		}
 	}
 
+	if (!pCore->render.due(10000)) return this;
+
 	pD->menuItemShow("Hot Gun", menu_list[item], 0, false);
 	return this;
 }
@@ -1925,32 +2049,143 @@ MODE* MENU_GUN::loop(void) {
 //---------------------- The Fail mode: display error message --------------------
 void MFAIL::init(void) {
 	RENC*	pEnc	= &pCore->encoder;
+	pCore->recorder.freeze();									// Keep the data of the last cycles before the failure
 	pEnc->reset(0, 0, 1, 1, 1, false);
 	pCore->buzz.failedBeep();
-	update_screen = 0;
+	pCore->render.request();
 }
 
 MODE* MFAIL::loop(void) {
 	DSPL*	pD		= &pCore->dspl;
 	RENC*	pEnc	= &pCore->encoder;
-	if (pEnc->buttonStatus()) {
+	uint8_t button	= pEnc->buttonStatus();
+	if (button == 1) {
 		return mode_return;
+	} else if (button == 2) {									// Browse the flight recorder
+		return mode_lpress;
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 60000;
+	if (!pCore->render.due(60000)) return this;
 
 	pD->errorShow();
 	return this;
 }
 
+//---------------------- The Flight recorder mode: browse the last control cycles -
+void MFLREC::init(void) {
+	FLREC*	pRec	= &pCore->recorder;
+	pRec->freeze();												// The data should not be changed while browsing
+	uint8_t size	= pRec->size();
+	uint8_t last	= size?size-1:0;
+	FLREC_ENTRY e	= pRec->read(last);
+	bool gun		= (e.flags & FLR_GUN_HOT) || (!(e.flags & FLR_IRON_HOT) && e.gun_pwm > 0);
+	uint16_t pos	= gun?size+last:last;						// The Hot Air Gun records follow the IRON ones
+	pCore->encoder.reset(pos, 0, size?2*size-1:0, 1, 5, false);
+	old_cursor		= pos;
+	dump			= false;
+	note			= 0;
+	dump_stall.cancel();
+	idle.start(idle_timeout);
+	pCore->render.request();
+}
+
+/*
+ * Rotate the encoder to browse the IRON records, then the Hot Air Gun ones.
+ * Short press or the idle timeout returns to the main mode.
+ * Long press dumps the records to the host by the telemetry stream and returns to the main mode.
+ * If the host does not read the stream, the data is kept frozen and the browsing continues
+ */
+MODE* MFLREC::loop(void) {
+	DSPL*	pD		= &pCore->dspl;
+	CFG*	pCFG	= &pCore->cfg;
+	FLREC*	pRec	= &pCore->recorder;
+	uint8_t	size	= pRec->size();
+
+	if (dump) {
+		while (dump_index < size) {
+			uint8_t	data[sizeof(FLREC_ENTRY) + 2];
+			data[0]	= dump_index;
+			data[1]	= size;
+			FLREC_ENTRY e = pRec->read(dump_index);
+			memcpy(&data[2], &e, sizeof(FLREC_ENTRY));
+			if (!tlmSendData(TLM_FLIGHT, data, sizeof(data)))
+				break;											// The stream buffer is full, continue later
+			++dump_index;
+			dump_stall.start(stall_timeout);
+		}
+		if (dump_index >= size)
+			return leave();
+		if (dump_stall.expired()) {								// No host is reading the stream, keep the data
+			dump	= false;
+			note	= "no host";
+			idle.start(idle_timeout);
+			pCore->render.request();
+		}
+		return this;
+	}
+
+	uint16_t cursor	= pCore->encoder.read();
+	uint8_t  button	= pCore->encoder.buttonStatus();
+	bool	 gun	= (size > 0) && (cursor >= size);
+	uint8_t	 index	= gun?cursor-size:cursor;					// The record index
+	if (button == 1 || idle.expired()) {
+		return leave();
+	} else if (button == 2) {
+		dump		= true;
+		dump_index	= 0;
+		dump_stall.start(stall_timeout);
+		pD->flightShow(pRec, index, gun, "dump to host");
+		return this;
+	}
+	if (cursor != old_cursor) {
+		old_cursor	= cursor;
+		note		= 0;
+		idle.start(idle_timeout);
+		pCore->render.request();
+	}
+
+	if (!pCore->render.due(1000)) return this;
+
+	char info[24];
+	char *p = info;
+	if (size == 0) {
+		fmtStr(p, "no data");
+	} else if (note) {
+		fmtStr(p, note);
+	} else {
+		FLREC_ENTRY e	= pRec->read(index);
+		uint32_t ago	= (uint32_t)(size - 1 - index) * cycle_ms;	// Time before the last record, ms
+		*p++ = gun?'g':'i';
+		*p++ = '-';
+		p = fmtInt(p, ago / 1000);
+		*p++ = '.';
+		p = fmtInt(p, (ago % 1000) / 10, 2, '0');
+		p = fmtStr(p, "s ");
+		int16_t ambient	= pCore->iron.ambientTemp();
+		uint16_t t		= gun?pCFG->tempToHuman(e.gun_temp, ambient, DEV_GUN):pCFG->tempToHuman(e.iron_temp, ambient, DEV_IRON);
+		p = fmtInt(p, t);
+		*p++ = ' ';
+		fmtInt(p, gun?e.gun_pwm:e.iron_pwm);
+	}
+	pD->flightShow(pRec, index, gun, info);
+	return this;
+}
+
+// Let the recorder write again unless the failure is still there, the data before the failure should be kept
+MODE* MFLREC::leave(void) {
+	if (!pCore->iron.isOverheat() && !pCore->hotgun.isOverheat())
+		pCore->recorder.unfreeze();
+	return mode_return;
+}
+
 //---------------------- The About dialog mode. Show about message ---------------
 void MABOUT::init(void) {
 	RENC*	pEnc	= &pCore->encoder;
-	pEnc->reset(0, 0, 1, 1, 1, false);
+	pEnc->reset(0, 0, 2, 1, 1, false);
 	setTimeout(20);												// Show version for 20 seconds
 	resetTimeout();
-	update_screen = 0;
+	page			= 0;
+	pCore->render.request();
 }
 
 MODE* MABOUT::loop(void) {
@@ -1963,10 +2198,29 @@ MODE* MABOUT::loop(void) {
 		return mode_lpress;										// Activate debug mode
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 60000;
+	uint8_t p = pEnc->read();									// Rotate the encoder to show the startup time or usage statistics
+	if (p != page) {
+		page = p;
+		resetTimeout();
+		pCore->render.request();
+	}
+
+	if (!pCore->render.due(60000)) return this;
 
-	pD->showVersion();
+	if (page == 0) {
+		pD->showVersion();
+	} else if (page == 1) {
+		uint16_t phase_ms[6];
+		for (uint8_t i = 0; i < 5; ++i)							// Duration of each startup phase
+			phase_ms[i] = bootPhaseTime((BOOT_PHASE)(i+1)) - bootPhaseTime((BOOT_PHASE)i);
+		phase_ms[5] = bootPhaseTime(BOOT_READY);				// Time since reset till the controller is ready
+		pD->bootShow(phase_ms);
+	} else {
+		USAGE*	pU	= &pCore->usage;
+		const STATS &s = pU->tipStats();
+		pD->usageShow(pCore->cfg.ironTipName(), pU->health(), s.iron_sec, s.iron_cycles, s.iron_energy, pU->gunSec(),
+			pCore->cfg.droppedStatsTipName());
+	}
 	return this;
 }
 
@@ -1974,7 +2228,7 @@ MODE* MABOUT::loop(void) {
 void MDEBUG::init(void) {
 	gun_mode = false;
 	pCore->encoder.reset(0, 0, max_iron_power, 1, 5, false);
-	update_screen = 0;
+	pCore->render.request();
 }
 
 MODE* MDEBUG::loop(void) {
@@ -1998,7 +2252,7 @@ MODE* MDEBUG::loop(void) {
 	uint16_t pwr = pCore->encoder.read();
 	if (pwr != old_power) {
 		old_power = pwr;
-		update_screen = 0;
+		pCore->render.request();
 		if (gun_mode) {
 			pHG->fanFixed(pwr);
 		} else {
@@ -2010,8 +2264,7 @@ MODE* MDEBUG::loop(void) {
 	   	return mode_lpress;
 	}
 
-	if (HAL_GetTick() < update_screen) return this;
-	update_screen = HAL_GetTick() + 491;						// The screen update period is a primary number to update TIM1 counter value
+	if (!pCore->render.due(491)) return this;	// The screen update period is a primary number to update TIM1 counter value
 
 	uint16_t data[4];
 	data[2]		= pIron->ambientInternal();
@@ -2025,7 +2278,7 @@ MODE* MDEBUG::loop(void) {
 		data[1] 	= pIron->unitCurrent();
 		data[3]		= pIron->reedInternal();
 	}
-	pD->debugShow(gun_mode, pwr, pIron->isConnected(), pHG->isConnected(), data);
+	pD->debugShow(gun_mode, pwr, pIron->isConnected(), pHG->isConnected(), data, idlePercent());
 	return this;
 }
 
@@ -4,8 +4,166 @@
  *  Created on: 31 . 2019 .
  *      Author: Alex
  */
+#include <string.h>
 #include "oled.h"
 
+/*
+ * The display frame is sent by DMA. Between oledTransferBegin() and oledTransferCommit() the u8x8 byte callbacks
+ * do not send the data, they put the transfer list into the queue instead. The command bytes are copied into
+ * the queue buffer because u8x8 passes them in the local variables. The data transfer points to the frame buffer,
+ * so the frame buffer should not be changed till the transfer is complete, see DSPL::sendBuffer().
+ * The next transfer of the queue is started by the DMA transfer complete interrupt.
+ * If the frame was abandoned (the transfer error or timeout), the display content is unknown, see oledAborted()
+ */
+#define OLED_QUEUE_SZ	(24)								// Maximum number of transfers in one frame
+#define OLED_CMD_SZ		(64)								// The command bytes buffer size
+
+typedef struct s_oled_transfer {
+	uint8_t		*data;
+	uint8_t		size;
+	bool		dc;											// false - commands, true - display data
+} OLED_TRANSFER;
+
+static	OLED_TRANSFER		queue[OLED_QUEUE_SZ];
+static	uint8_t				cmd_buff[OLED_CMD_SZ];
+static	uint8_t				q_len		= 0;				// The number of transfers in the queue
+static	uint8_t				cmd_len		= 0;				// The number of bytes in the command buffer
+static	volatile uint8_t	q_index		= 0;				// The transfer being sent
+static	volatile bool		busy		= false;			// The queue is being sent by DMA
+static	volatile bool		aborted		= false;			// The frame was not sent completely
+static	bool				recording	= false;			// Record the transfers instead of sending them
+static	bool				dc_data		= false;			// Current D/C status while recording
+static	bool				use_i2c		= false;			// The display is connected via I2C bus
+static	u8x8_t				*p_u8x8		= 0;
+const static uint32_t		oled_timeout	= 100;			// Maximum time to send the frame, ms
+
+static void oledFinish(bool abort) {
+	if (!use_i2c && p_u8x8)
+		HAL_GPIO_WritePin(OLED_CS_GPIO_Port, OLED_CS_Pin, (GPIO_PinState)(p_u8x8->display_info->chip_disable_level));
+	if (abort) aborted = true;
+	busy = false;
+}
+
+// Stop the stuck transfer. Otherwise the HAL handle stays busy, so the next frames and the EEPROM on the shared I2C bus fail
+static void oledAbortTransfer(void) {
+	if (use_i2c) {
+		if (HAL_I2C_Master_Abort_IT(&I2C_HANDLER, OLED_I2C_ADDR<<1) != HAL_OK) {
+			HAL_I2C_DeInit(&I2C_HANDLER);					// HAL does not abort the memory write, reset the peripheral and its DMA channel
+			HAL_I2C_Init(&I2C_HANDLER);
+		}
+	} else {
+		HAL_SPI_Abort(&SPI_HANDLER);						// Stops the DMA channel as well
+	}
+}
+
+static void oledStartTransfer(void) {
+	OLED_TRANSFER *t = &queue[q_index];
+	HAL_StatusTypeDef status = HAL_OK;
+	if (use_i2c) {
+		status = HAL_I2C_Mem_Write_DMA(&I2C_HANDLER, OLED_I2C_ADDR<<1, t->dc?0x40:0, 1, t->data, t->size);
+	} else {
+		HAL_GPIO_WritePin(OLED_DC_GPIO_Port, OLED_DC_Pin, t->dc?GPIO_PIN_SET:GPIO_PIN_RESET);
+		status = HAL_SPI_Transmit_DMA(&SPI_HANDLER, t->data, t->size);
+	}
+	if (status != HAL_OK)									// Drop the rest of the frame, do not hang
+		oledFinish(true);
+}
+
+static void oledNextTransfer(void) {
+	if (!busy) return;
+	if (++q_index < q_len) {
+		oledStartTransfer();
+	} else {
+		oledFinish(false);
+	}
+}
+
+// Put the transfer to the queue. If the queue is full, send it and wait for complete
+static void oledRecord(u8x8_t *u8x8, bool i2c, uint8_t *data, uint8_t size) {
+	p_u8x8	= u8x8;
+	use_i2c	= i2c;
+	if (q_len >= OLED_QUEUE_SZ || (!dc_data && cmd_len + size > OLED_CMD_SZ)) {
+		oledTransferCommit();
+		oledWait();
+		recording = true;
+	}
+	if (!dc_data) {
+		uint8_t *cmd = &cmd_buff[cmd_len];
+		memcpy(cmd, data, size);
+		cmd_len += size;
+		if (q_len > 0) {									// Join the consecutive commands into one transfer
+			OLED_TRANSFER *prev = &queue[q_len-1];
+			if (!prev->dc && prev->data + prev->size == cmd) {
+				prev->size += size;
+				return;
+			}
+		}
+		data = cmd;
+	}
+	queue[q_len].data	= data;
+	queue[q_len].size	= size;
+	queue[q_len].dc		= dc_data;
+	++q_len;
+}
+
+void oledTransferBegin(void) {
+	oledWait();
+	q_len		= 0;
+	cmd_len		= 0;
+	dc_data		= false;
+	recording	= true;
+}
+
+// Start sending the recorded transfers. Returns immediately, the queue is sent by DMA interrupts
+void oledTransferCommit(void) {
+	recording = false;
+	if (q_len == 0) return;
+	q_index	= 0;
+	busy	= true;
+	if (!use_i2c)
+		HAL_GPIO_WritePin(OLED_CS_GPIO_Port, OLED_CS_Pin, (GPIO_PinState)(p_u8x8->display_info->chip_enable_level));
+	oledStartTransfer();
+}
+
+bool oledBusy(void) {
+	return busy;
+}
+
+void oledWait(void) {
+	uint32_t start = HAL_GetTick();
+	while (busy) {
+		if (HAL_GetTick() - start >= oled_timeout) {							// Something is wrong, abandon the frame
+			oledAbortTransfer();
+			oledFinish(true);
+			break;
+		}
+	}
+	q_len = cmd_len = 0;
+}
+
+// True once after the frame was abandoned
+bool oledAborted(void) {
+	if (!aborted) return false;
+	aborted = false;
+	return true;
+}
+
+extern "C" void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &SPI_HANDLER) oledNextTransfer();
+}
+
+extern "C" void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &SPI_HANDLER && busy) oledFinish(true);
+}
+
+extern "C" void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == &I2C_HANDLER) oledNextTransfer();
+}
+
+extern "C" void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	if (hi2c == &I2C_HANDLER && busy) oledFinish(true);
+}
+
 extern "C" uint8_t u8x8_gpio_and_delay_stm32(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
 	switch (msg) {
 		case U8X8_MSG_DELAY_NANO:							// delay arg_int * 1 nano second
@@ -32,19 +190,30 @@ extern "C" uint8_t u8x8_gpio_and_delay_stm32(u8x8_t *u8x8, uint8_t msg, uint8_t
 extern "C" uint8_t u8x8_byte_stm32_hw_spi(u8x8_t *u8g2, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
 	switch (msg) {
 		case U8X8_MSG_BYTE_SEND:
+			if (recording) {
+				oledRecord(u8g2, false, (uint8_t *)arg_ptr, arg_int);
+				break;
+			}
+			oledWait();
 			while (HAL_SPI_STATE_READY != HAL_SPI_GetState(&SPI_HANDLER)) { }
 			HAL_SPI_Transmit(&SPI_HANDLER, (uint8_t *)arg_ptr, arg_int, 100);
 			break;
 		case U8X8_MSG_BYTE_INIT:
 			break;
 		case U8X8_MSG_BYTE_SET_DC:
+			if (recording) {
+				dc_data = (arg_int != 0);
+				break;
+			}
 			HAL_GPIO_WritePin(OLED_DC_GPIO_Port, OLED_DC_Pin, arg_int?GPIO_PIN_SET:GPIO_PIN_RESET);
 			break;
 		case U8X8_MSG_BYTE_START_TRANSFER:
+			if (recording) break;							// Chip select is managed by oledTransferCommit()
 			HAL_GPIO_WritePin(OLED_CS_GPIO_Port, OLED_CS_Pin, (GPIO_PinState)(u8g2->display_info->chip_enable_level));
 			u8g2->gpio_and_delay_cb(u8g2, U8X8_MSG_DELAY_NANO, u8g2->display_info->post_chip_enable_wait_ns, NULL);
 			break;
 		case U8X8_MSG_BYTE_END_TRANSFER:
+			if (recording) break;
 			u8g2->gpio_and_delay_cb(u8g2, U8X8_MSG_DELAY_NANO, u8g2->display_info->pre_chip_disable_wait_ns, NULL);
 			HAL_GPIO_WritePin(OLED_CS_GPIO_Port, OLED_CS_Pin, (GPIO_PinState)(u8g2->display_info->chip_disable_level));
 			break;
@@ -59,6 +228,11 @@ extern "C" uint8_t u8x8_byte_stm32_hw_i2c(u8x8_t *u8g2, uint8_t msg, uint8_t arg
 
 	switch(msg)  {
 		case U8X8_MSG_BYTE_SEND:
+			if (recording) {
+				oledRecord(u8g2, true, (uint8_t *)arg_ptr, arg_int);
+				break;
+			}
+			oledWait();
 			while (HAL_I2C_STATE_READY != HAL_I2C_GetState(&I2C_HANDLER)) { }
 			HAL_I2C_Mem_Write(&I2C_HANDLER, OLED_I2C_ADDR<<1, (dc == 0)?0:0x40, 1, (uint8_t *)arg_ptr, arg_int, HAL_MAX_DELAY);
 			break;
@@ -67,6 +241,7 @@ extern "C" uint8_t u8x8_byte_stm32_hw_i2c(u8x8_t *u8g2, uint8_t msg, uint8_t arg
 			break;
 		case U8X8_MSG_BYTE_SET_DC:
 			dc = arg_int;
+			dc_data = (arg_int != 0);
 			break;
 		case U8X8_MSG_BYTE_START_TRANSFER:
 			break;
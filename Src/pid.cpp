@@ -100,23 +100,31 @@ int32_t PID::reqPower(int16_t temp_set, int16_t temp_curr) {
 	if (use_force && temp_curr + 100 < temp_set) {			// Aggressive heat-up mode, use Kp_force and Ki_forse only
 		if (temp_h0 == 0) {									// Use direct formulae because do not know previous temperature
 			int32_t	i_summ 	= temp_set - temp_curr;
-			power = Kp_force*(temp_set - temp_curr) + Ki_force * i_summ;
+			term_p	= Kp_force*(temp_set - temp_curr);
+			term_i	= Ki_force * i_summ;
+			term_d	= 0;
+			power 	= term_p + term_i;
 		} else {
 			int32_t kp = Kp_force * (temp_h1 	- temp_curr);
 			int32_t ki = Ki_force * (temp_set	- temp_curr);
 			int32_t delta_p = kp + ki;
 			power += delta_p;								// Power is stored multiplied by denominator!
+			term_p	= kp; term_i = ki; term_d = 0;
 		}
 	} else {												// Use regular PID parameters near preset temperature
 		if (temp_h0 == 0) {									// Use direct formulae because do not know previous temperature
 			int32_t	i_summ 	= temp_set - temp_curr;
-			power = Kp*(temp_set - temp_curr) + Ki * i_summ;
+			term_p	= Kp*(temp_set - temp_curr);
+			term_i	= Ki * i_summ;
+			term_d	= 0;
+			power 	= term_p + term_i;
 		} else {
 			int32_t kp = Kp * (temp_h1 	- temp_curr);
 			int32_t ki = Ki * (temp_set	- temp_curr);
 			int32_t kd = Kd * (temp_h0 	+ temp_curr - 2 * temp_h1);
 			int32_t delta_p = kp + ki + kd;
 			power += delta_p;								// Power is stored multiplied by denominator!
+			term_p	= kp; term_i = ki; term_d = kd;
 		}
 	}
 	temp_h0 = temp_h1;
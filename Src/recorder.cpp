@@ -0,0 +1,19 @@
+/*
+ * recorder.cpp
+ *
+ */
+
+#include "recorder.h"
+
+void FLREC::add(const FLREC_ENTRY &e) {
+	if (frozen) return;
+	data[head] = e;
+	head = (head + 1) & (FLREC_SIZE-1);
+	if (count < FLREC_SIZE) ++count;
+}
+
+const FLREC_ENTRY& FLREC::read(uint8_t index) {
+	if (index >= count) index = count - 1;
+	uint8_t i = (head - count + index) & (FLREC_SIZE-1);
+	return data[i];
+}
@@ -3,6 +3,7 @@
  *
  */
 
+#include <stdlib.h>
 #include "stat.h"
 #include "tools.h"
 
@@ -23,13 +24,12 @@ int32_t EMP_AVERAGE::read(void) {
 }
 
 int32_t	HIST::read(void) {
-	int32_t sum = 0;
 	if (len == 0) return 0;
 	if (len == 1) return queue[0];
-	for (uint8_t i = 0; i < len; ++i) sum += queue[i];
-	sum += len >> 1;								// round the average
-	sum /= len;
-	return sum;
+	int32_t avg = (int32_t)sum;
+	avg += len >> 1;								// round the average
+	avg /= len;
+	return avg;
 }
 
 int32_t	HIST::average(int32_t value) {
@@ -38,34 +38,284 @@ int32_t	HIST::average(int32_t value) {
 }
 
 void HIST::update(int32_t value) {
+	uint32_t v = value;
 	if (len < max_len) {
 		queue[len++] = value;
 	} else {
+		uint32_t old = queue[index];
+		sum		-= old;
+		sum_sq	-= old * old;
 		queue[index] = value;
 		if (++index >= max_len) index = 0;			// Use ring buffer
 	}
+	sum		+= v;
+	sum_sq	+= v * v;
 }
 
+// sum((q - avg)^2) = sum(q^2) - 2*avg*sum(q) + len*avg^2, modulo 2^32 it is the same as the direct summation
 uint32_t HIST::dispersion(void) {
 	if (len < 3) return 1000;
-	uint32_t sum = 0;
 	uint32_t avg = read();
-	for (uint8_t i = 0; i < len; ++i) {
-		int32_t q = queue[i];
-		q -= avg;
-		q *= q;
-		sum += q;
+	uint32_t d	 = sum_sq - 2 * avg * sum + len * avg * avg;
+	d += len >> 1;
+	d /= len;
+	return d;
+}
+
+/*
+ * Solve the normal equations A * c = b of the least squares method by Gauss elimination with partial pivoting
+ * A[i][j] = sum(t^(i+j)) and b[i] = sum(Yk * t^i), Q20
+ */
+bool POLYFIT::fit(const uint16_t x[], const uint16_t y[], uint8_t n, uint8_t degree) {
+	if (degree > POLY_MAX_DEGREE)	degree = POLY_MAX_DEGREE;
+	if (n > POLY_MAX_POINTS)		n = POLY_MAX_POINTS;
+	if (n <= degree) return false;
+	x_min = x_max = x[0];
+	for (uint8_t i = 1; i < n; ++i) {
+		if (x[i] < x_min) x_min = x[i];
+		if (x[i] > x_max) x_max = x[i];
+	}
+	x_center	= (x_min + x_max) >> 1;
+	x_scale		= (x_max - x_min + 1) >> 1;
+	if (x_scale < 1) x_scale = 1;
+
+	const uint8_t	size = degree + 1;
+	int64_t	a[POLY_MAX_DEGREE+1][POLY_MAX_DEGREE+1];
+	int64_t	b[POLY_MAX_DEGREE+1];
+	int64_t	sum_t[2*POLY_MAX_DEGREE+1];
+	for (uint8_t i = 0; i < 2*size-1; ++i) sum_t[i] = 0;
+	for (uint8_t i = 0; i < size; ++i) b[i] = 0;
+	for (uint8_t k = 0; k < n; ++k) {
+		int64_t t	= normalize(x[k]);
+		int64_t p	= 1 << q;								// t^0
+		for (uint8_t i = 0; i < 2*size-1; ++i) {
+			sum_t[i] += p;
+			if (i < size) b[i] += p * y[k];
+			p = (p * t) >> q;
+		}
+	}
+	for (uint8_t i = 0; i < size; ++i)
+		for (uint8_t j = 0; j < size; ++j)
+			a[i][j] = sum_t[i+j];
+
+	for (uint8_t i = 0; i < size; ++i) {
+		uint8_t pivot = i;
+		for (uint8_t r = i+1; r < size; ++r)
+			if (llabs(a[r][i]) > llabs(a[pivot][i])) pivot = r;
+		if (llabs(a[pivot][i]) < min_pivot) return false;
+		if (pivot != i) {
+			for (uint8_t k = 0; k < size; ++k) {
+				int64_t s = a[i][k]; a[i][k] = a[pivot][k]; a[pivot][k] = s;
+			}
+			int64_t s = b[i]; b[i] = b[pivot]; b[pivot] = s;
+		}
+		for (uint8_t r = i+1; r < size; ++r) {
+			int64_t f = a[r][i];
+			for (uint8_t k = i; k < size; ++k)
+				a[r][k] -= a[i][k] * f / a[i][i];
+			b[r] -= b[i] * f / a[i][i];
+		}
+	}
+	for (int8_t i = size-1; i >= 0; --i) {					// Back substitution, the coefficients are Q16
+		int64_t s = b[i] << 16;
+		for (uint8_t k = i+1; k < size; ++k)
+			s -= a[i][k] * c[k];
+		c[i] = s / a[i][i];
+	}
+	for (uint8_t i = size; i <= POLY_MAX_DEGREE; ++i) c[i] = 0;
+	deg = degree;
+	return true;
+}
+
+int32_t POLYFIT::poly(int32_t x) {
+	int64_t t	= normalize(x);
+	int64_t acc	= c[deg];
+	for (int8_t k = deg-1; k >= 0; --k)
+		acc = ((acc * t) >> q) + c[k];						// Horner method
+	return (acc + (1 << 15)) >> 16;
+}
+
+// Extrapolate the polynomial linearly by the chord of the last quarter of the fitted interval
+int32_t POLYFIT::value(int32_t x) {
+	int32_t d = (x_max - x_min) >> 2;
+	if (d < 1) d = 1;
+	if (x > x_max) {
+		int32_t y1 = poly(x_max);
+		return y1 + (x - x_max) * (y1 - poly(x_max - d)) / d;
+	} else if (x < x_min) {
+		int32_t y1 = poly(x_min);
+		return y1 - (x_min - x) * (poly(x_min + d) - y1) / d;
+	}
+	return poly(x);
+}
+
+void SETTLE::update(int32_t value) {
+	if (++skip < dec) return;
+	skip = 0;
+	queue[index] = value;
+	if (++index >= SETTLE_WINDOW) index = 0;
+	if (len < SETTLE_WINDOW) ++len;
+	++count;
+}
+
+/*
+ * Fit the line y = a + b*i to the window samples (i = 0..n-1), y is the deviation from the target:
+ * Sxx = n*(n^2-1)/12, Sxy = sum(i*y) - (n-1)/2*sum(y), Syy = sum(y^2) - sum(y)^2/n
+ * drift = b*(n-1) = Sxy*(n-1)/Sxx, the residual variance s^2 = (Syy - Sxy^2/Sxx) / (n-2)
+ * standard error of the mean = s/sqrt(n), standard error of the drift = s*(n-1)/sqrt(Sxx)
+ * All the values are calculated in Q4 fixed point
+ */
+bool SETTLE::settled(int32_t target, uint16_t tolerance, uint8_t confidence) {
+	const int64_t n = SETTLE_WINDOW;
+	int32_t	y[SETTLE_WINDOW];
+	if (!copy(y)) return false;
+	for (uint8_t i = 0; i < n; ++i)
+		y[i] -= target;
+
+	int64_t	sum_y = 0, sum_iy = 0, sum_y2 = 0;
+	for (uint8_t i = 0; i < n; ++i) {
+		sum_y	+= y[i];
+		sum_iy	+= i * y[i];
+		sum_y2	+= (int64_t)y[i] * y[i];
+	}
+	const int64_t sxx	= n * (n*n - 1) / 12;
+	int64_t sxy2		= 2 * sum_iy - (n - 1) * sum_y;		// 2*Sxy
+	int64_t nsyy		= n * sum_y2 - sum_y * sum_y;		// n*Syy
+	int64_t ssr			= 4 * sxx * nsyy - n * sxy2 * sxy2;	// 4*n*Sxx*SSR
+	if (ssr < 0) ssr = 0;
+	uint32_t s			= isqrt((ssr << 8) / (4 * n * sxx * (n - 2)));	// Residual standard deviation, Q4
+
+	uint32_t mean		= (llabs(sum_y) << 4) / n;
+	uint32_t drift		= (llabs(sxy2) * (n - 1) << 4) / (2 * sxx);
+	uint32_t se_mean	= (s << 4) / isqrt(n << 8);
+	uint32_t se_drift	= ((uint64_t)s * (n - 1) << 4) / isqrt(sxx << 8);
+	uint32_t tol		= (uint32_t)tolerance << 4;
+	return (mean  + se_mean  * confidence / 10 <= tol) &&
+		   (drift + se_drift * confidence / 10 <= tol);
+}
+
+bool SETTLE::copy(int32_t y[]) {
+	if (len < SETTLE_WINDOW) return false;
+	__disable_irq();
+	for (uint8_t i = 0; i < SETTLE_WINDOW; ++i) {
+		uint8_t k = index + i;
+		if (k >= SETTLE_WINDOW) k -= SETTLE_WINDOW;
+		y[i] = queue[k];
+	}
+	__enable_irq();
+	return true;
+}
+
+/*
+ * Aitken delta-squared method: three equally spaced points y0, y1, y2 of the exponential approach
+ * give the limit y = y2 - (y2-y1)^2 / ((y2-y1) - (y1-y0)). The points are the averages of 'group' samples (Q4).
+ * The approach should be decaying fast enough, otherwise the prediction is not reliable.
+ * The standard deviation of the limit is sigma(y) = sigma(yi) * sqrt(d2^4 + 4*d1^2*d2^2 + d1^4) / (d2-d1)^2,
+ * where d1 = y1-y0, d2 = y2-y1 and sigma(yi) is the noise of the averaged points
+ */
+bool SETTLE::aitken(int32_t y[], int32_t *final, uint32_t *sigma) {
+	int32_t m[3];
+	for (uint8_t k = 0; k < 3; ++k) {
+		int32_t sum = 0;
+		for (uint8_t i = 0; i < group; ++i)
+			sum += y[k*group + i];
+		m[k] = (sum << 4) / group;
 	}
-	sum += len >> 1;
-	sum /= len;
-	return sum;
+	int32_t d1 = m[1] - m[0];
+	int32_t d2 = m[2] - m[1];
+	uint32_t sigma_m2 = noise2 / group;						// The noise variance of the averaged points, Q8
+	if (abs(d1) <= 16 && abs(d2) <= 16) {					// The value does not change already
+		*final = m[2];
+		*sigma = isqrt(sigma_m2);
+		return true;
+	}
+	if ((d1 > 0) != (d2 > 0) || abs(d2) * 8 > abs(d1) * 7)	// Not decaying or decaying too slow
+		return false;
+	int64_t d	= d2 - d1;
+	*final		= m[2] - (int64_t)d2 * d2 / d;
+	int64_t a1	= (int64_t)d1 * d1;
+	int64_t a2	= (int64_t)d2 * d2;
+	int64_t k2	= ((a2 * a2 + 4 * a1 * a2 + a1 * a1) << 8) / (d * d * d * d);	// Noise amplification squared, Q8
+	*sigma		= isqrt(((uint64_t)sigma_m2 * k2) >> 8);
+	return true;
 }
 
-void SWITCH::init(uint8_t h_len, uint16_t off, uint16_t on) {
+/*
+ * Predict the final value by two overlapping sets of the window samples shifted by one sample.
+ * The error bound is two standard deviations of the prediction, but not less than the difference between
+ * two predictions, that shows how well the exponential model fits the data.
+ * The noise of the samples is estimated by the second differences, so the trend does not affect it:
+ * noise^2 = sum((y[i+1] - 2*y[i] + y[i-1])^2) / (6*(n-2))
+ */
+bool SETTLE::predict(int32_t *final, uint16_t *bound) {
+	int32_t	y[SETTLE_WINDOW];
+	if (!copy(y)) return false;
+	int64_t sum = 0;
+	for (uint8_t i = 1; i < SETTLE_WINDOW-1; ++i) {
+		int64_t d = y[i+1] - 2*y[i] + y[i-1];
+		sum += d * d;
+	}
+	noise2 = (sum << 8) / (6 * (SETTLE_WINDOW-2));
+
+	int32_t		p_old, p_new;
+	uint32_t	s_old, s_new;
+	if (!aitken(y, &p_old, &s_old) || !aitken(&y[SETTLE_WINDOW - 3*group], &p_new, &s_new)) return false;
+	uint32_t b	= 2 * s_new;
+	uint32_t d	= abs(p_new - p_old);
+	if (d > b) b = d;
+	*final	= (p_new + 8) >> 4;
+	*bound	= constrain((b + 15) >> 4, 0, 0xFFFF);
+	return true;
+}
+
+void KALMAN::setup(uint32_t loss, uint32_t gain, uint32_t q_temp, uint32_t q_model, uint32_t r) {
+	a		= loss;
+	b		= gain;
+	q_t		= q_temp;
+	q_d		= q_model;
+	r_z		= r;
+	ready	= false;
+}
+
+/*
+ * Predict:	T = f*T + b*P + d, F = [f 1; 0 1], P = F*P*F' + Q, where f = 1 - a
+ * Update:	y = z - T, S = p00 + R, K = [p00; p01] / S, state += K*y, P = (I - K*[1 0])*P
+ */
+int32_t KALMAN::update(int32_t z, uint16_t power) {
+	if (!ready) {											// Start from the first measurement
+		t		= z << 16;
+		d		= 0;
+		p00		= r_z;
+		p01		= 0;
+		p11		= q_d << 4;
+		ready	= true;
+		return z;
+	}
+	const int64_t f = (1 << 24) - a;
+	t	= (((int64_t)t * f) >> 24) + (((int64_t)b * power) >> 8) + d;
+	p00	= ((((f * f) >> 24) * p00) >> 24) + ((2 * f * p01) >> 24) + p11 + q_t;
+	p01	= ((f * p01) >> 24) + p11;
+	p11	+= q_d;
+
+	int64_t	y	= ((int64_t)z << 16) - t;
+	int64_t	s	= p00 + r_z;
+	int64_t	k0	= (p00 << 16) / s;							// Kalman gains, Q16
+	int64_t	k1	= (p01 << 16) / s;
+	t	+= (k0 * y) >> 16;
+	d	+= (k1 * y) >> 16;
+	p11	-= (k1 * p01) >> 16;
+	p01	 = ((65536 - k0) * p01) >> 16;
+	p00	 = ((65536 - k0) * p00) >> 16;
+	return read();
+}
+
+void SWITCH::init(uint8_t h_len, uint16_t off, uint16_t on, uint8_t confirm) {
 	EMP_AVERAGE::length(h_len);
     if (on < off) on = off;
     on_val    	= on;
     off_val   	= off;
+    confirm_n	= confirm;
+    streak		= 0;
     mode		= false;
 }
 
@@ -82,16 +332,29 @@ void SWITCH::update(uint16_t value) {
 	uint16_t max_val = on_val  + (on_val  >> 1);
 	uint16_t min_val = off_val - (off_val >> 1);
 	value = constrain(value, min_val, max_val);
+	if (confirm_n) {
+		bool against = mode?(value < off_val):(value > on_val);
+		streak = against?streak+1:0;
+		if (streak >= confirm_n) {							// The raw readings confirmed the new status, restart the average from the value
+			EMP_AVERAGE::preset(value);
+			sw_changed	= true;
+			mode		= !mode;
+			streak		= 0;
+			return;
+		}
+	}
 	uint16_t avg = EMP_AVERAGE::average(value);
 	if (mode) {
 		if (avg < off_val) {
 			sw_changed	= true;
 			mode		= false;
+			streak		= 0;
 		}
 	} else {
 		if (avg > on_val) {
 			sw_changed = true;
 			mode 	= true;
+			streak	= 0;
 		}
 	}
 }
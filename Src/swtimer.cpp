@@ -0,0 +1,104 @@
+/*
+ * swtimer.cpp
+ *
+ */
+
+#include "swtimer.h"
+
+static SWTIMER				*wheel[SWTIMER_SLOTS] = {0};	// The heads of timer lists
+volatile static uint64_t	sw_now	= 0;					// The time since start, ms
+
+uint64_t swTime(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();										// 64-bit value cannot be read by single instruction
+	uint64_t now = sw_now;
+	__set_PRIMASK(primask);
+	return now;
+}
+
+void swTimerTick(void) {
+	uint64_t now = ++sw_now;
+	SWTIMER **slot = &wheel[now & (SWTIMER_SLOTS-1)];
+	SWTIMER *t = *slot;
+	while (t) {
+		if (t->expire <= now) {								// Other timers of the slot expire in the next wheel rounds
+			t->unlink();
+			t->fire();
+			// The callback can start or cancel any timer of the slot, restart from the slot head.
+			// The fired timers are not in the slot anymore or re-armed in the future, so the walk ends
+			t = *slot;
+		} else {
+			t = t->next;
+		}
+	}
+}
+
+void SWTIMER::start(uint32_t delay_ms, uint32_t period_ms) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (linked) unlink();
+	fired	= false;
+	period	= period_ms;
+	expire	= sw_now + delay_ms;
+	if (delay_ms == 0) {									// Expired already
+		fire();
+	} else {
+		link();
+	}
+	__set_PRIMASK(primask);
+}
+
+void SWTIMER::cancel(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (linked) unlink();
+	fired	= false;
+	__set_PRIMASK(primask);
+}
+
+bool SWTIMER::expired(void) {
+	if (!fired) return false;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();										// The timer can fire again between read and clear
+	bool e	= fired;
+	fired	= false;
+	__set_PRIMASK(primask);
+	return e;
+}
+
+uint32_t SWTIMER::remaining(void) {
+	if (!linked) return 0;
+	uint64_t now = swTime();
+	return (expire > now)?(uint32_t)(expire - now):0;
+}
+
+// Insert the timer at the head of the slot list. Should be called with the interrupts disabled
+void SWTIMER::link(void) {
+	SWTIMER **slot	= &wheel[expire & (SWTIMER_SLOTS-1)];
+	prev			= 0;
+	next			= *slot;
+	if (next) next->prev = this;
+	*slot			= this;
+	linked			= true;
+}
+
+// Remove the timer from the slot list. Should be called with the interrupts disabled
+void SWTIMER::unlink(void) {
+	if (prev) {
+		prev->next	= next;
+	} else {
+		wheel[expire & (SWTIMER_SLOTS-1)] = next;
+	}
+	if (next) next->prev = prev;
+	next = prev		= 0;
+	linked			= false;
+}
+
+void SWTIMER::fire(void) {
+	fired = true;
+	if (period) {											// Re-arm the periodic timer
+		expire += period;
+		link();
+	}
+	if (cb) (*cb)(cb_arg);
+}
@@ -0,0 +1,141 @@
+/*
+ * telemetry.cpp
+ *
+ *  The controller has no free UART pin (PA9 is the encoder, PA2 is ADC, PB10 is the OLED reset),
+ *  so the stream is written to the RAM ring buffer readable through the SWD debug port.
+ *  The buffer is described by the control block compatible with SEGGER RTT, so the standard tools
+ *  can read it, e.g. OpenOCD:
+ *  	rtt setup 0x20000000 0x5000 "SEGGER RTT"
+ *  	rtt start
+ *  	rtt server start 9090 0
+ *  and the stream is available on TCP port 9090
+ */
+
+#include <string.h>
+#include "telemetry.h"
+
+#define TLM_MAX_FRAME	(64)								// Maximum frame data size before encoding, bytes
+
+typedef struct s_rtt_buffer {
+	const char*			name;
+	char*				buffer;
+	uint32_t			size;
+	volatile uint32_t	wr_off;								// Written by the controller
+	volatile uint32_t	rd_off;								// Written by the host
+	uint32_t			flags;								// 0 - skip the data if the buffer is full
+} RTT_BUFFER;
+
+typedef struct s_rtt_cb {
+	char				id[16];								// "SEGGER RTT", the host looks for this signature in RAM
+	int32_t				max_up;
+	int32_t				max_down;
+	RTT_BUFFER			up[1];								// Controller to host
+	RTT_BUFFER			down[1];							// Host to controller, not used
+} RTT_CB;
+
+static char		up_buff[TLM_BUFF_SIZE];
+static char		down_buff[16];
+static uint32_t	dropped	= 0;								// The control cycle records lost
+static uint32_t	rejected = 0;								// The data frames rejected, the caller can send them again
+static uint16_t	seq		= 0;
+
+static RTT_CB	rtt_cb = {
+	"SEGGER RTT", 1, 1,
+	{ { "Telemetry", up_buff, 	TLM_BUFF_SIZE, 		0, 0, 0 } },
+	{ { "Telemetry", down_buff,	sizeof(down_buff),	0, 0, 0 } }
+};
+
+// CRC16-CCITT (polynom 0x1021, initial value 0xFFFF), nibble table
+static uint16_t crc16(const uint8_t *data, uint16_t len) {
+	static const uint16_t table[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+		0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+	};
+	uint16_t crc = 0xffff;
+	while (len--) {
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data & 0xf)];
+		++data;
+	}
+	return crc;
+}
+
+// Consistent Overhead Byte Stuffing: the encoded data has no zero bytes. Returns the encoded length
+static uint16_t cobsEncode(const uint8_t *src, uint16_t len, uint8_t *dst) {
+	uint16_t	code_pos	= 0;
+	uint16_t	out			= 1;
+	uint8_t		code		= 1;
+	for (uint16_t i = 0; i < len; ++i) {
+		if (src[i] == 0) {
+			dst[code_pos]	= code;
+			code_pos		= out++;
+			code			= 1;
+		} else {
+			dst[out++] = src[i];
+			if (++code == 0xff) {
+				dst[code_pos]	= code;
+				code_pos		= out++;
+				code			= 1;
+			}
+		}
+	}
+	dst[code_pos] = code;
+	return out;
+}
+
+// Append CRC to the data, encode the frame and write it to the stream buffer. The data buffer should have 2 extra bytes
+static bool sendFrame(uint8_t *raw, uint16_t size) {
+	uint8_t		frame[TLM_MAX_FRAME + 8];						// Data, CRC, COBS overhead and the delimiter
+
+	uint16_t crc = crc16(raw, size);
+	raw[size++]	= crc & 0xff;
+	raw[size++]	= crc >> 8;
+	uint16_t len = cobsEncode(raw, size, frame);
+	frame[len++] = 0;										// The frame delimiter
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();										// The stream is written by the ADC interrupt and by the main loop
+	RTT_BUFFER *b	= &rtt_cb.up[0];
+	uint32_t wr		= b->wr_off;
+	uint32_t room	= (b->rd_off - wr - 1) & (TLM_BUFF_SIZE-1);
+	if (room < len) {										// The host is not reading the stream, skip the frame
+		__set_PRIMASK(primask);
+		return false;
+	}
+	for (uint16_t i = 0; i < len; ++i) {
+		b->buffer[wr] = frame[i];
+		wr = (wr + 1) & (TLM_BUFF_SIZE-1);
+	}
+	__DMB();												// The data should be in memory before the host sees new write offset
+	b->wr_off = wr;
+	__set_PRIMASK(primask);
+	return true;
+}
+
+bool tlmSend(TLM_RECORD *rec) {
+	uint8_t	raw[sizeof(TLM_RECORD) + 2];
+	rec->version	= TLM_VERSION;
+	rec->seq		= seq++;
+	memcpy(raw, rec, sizeof(TLM_RECORD));
+	if (sendFrame(raw, sizeof(TLM_RECORD))) return true;
+	++dropped;
+	return false;
+}
+
+bool tlmSendData(uint8_t type, const void *data, uint8_t size) {
+	uint8_t	raw[TLM_MAX_FRAME + 2];
+	if (size >= TLM_MAX_FRAME) return false;
+	raw[0] = type;
+	memcpy(&raw[1], data, size);
+	if (sendFrame(raw, size + 1)) return true;
+	++rejected;
+	return false;
+}
+
+uint32_t tlmDropped(void) {
+	return dropped;
+}
+
+uint32_t tlmRejected(void) {
+	return rejected;
+}
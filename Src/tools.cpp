@@ -26,6 +26,23 @@ uint8_t gauge(uint8_t percent, uint8_t p_middle, uint8_t g_max) {
 	}
 }
 
+// Integer square root, rounded down
+uint32_t isqrt(uint64_t value) {
+	uint64_t	res = 0;
+	uint64_t	bit = (uint64_t)1 << 62;
+	while (bit > value) bit >>= 2;
+	while (bit) {
+		if (value >= res + bit) {
+			value	-= res + bit;
+			res		 = (res >> 1) + bit;
+		} else {
+			res		>>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
+
 // Arduino constrain() function: limits the value inside the required interval
 int32_t constrain(int32_t value, int32_t min, int32_t max) {
 	if (value < min)	return min;
@@ -42,3 +59,49 @@ int16_t celsiusToFahrenheit(int16_t cels) {
 int16_t fahrenheitToCelsius(int16_t fahr) {
 	return (fahr - 32*5 + 5) / 9;
 }
+
+// Write the integer value right aligned in the field of width characters filled by fill symbol, like "%5d" or "%03d"
+char* fmtInt(char *buff, int32_t value, uint8_t width, char fill) {
+	char		digits[10];
+	uint8_t		n			= 0;
+	bool		negative	= (value < 0);
+	uint32_t	v			= negative?0u - (uint32_t)value:(uint32_t)value;	// INT32_MIN safe
+	do {
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	uint8_t len = n + (negative?1:0);
+	if (negative && fill == '0') *buff++ = '-';
+	for ( ; len < width; ++len) *buff++ = fill;
+	if (negative && fill != '0') *buff++ = '-';
+	while (n) *buff++ = digits[--n];
+	*buff = '\0';
+	return buff;
+}
+
+// Copy the string to the buffer and pad it with spaces up to width characters, like "%-5s"
+char* fmtStr(char *buff, const char *str, uint8_t width) {
+	uint8_t len = 0;
+	while (*str) {
+		*buff++ = *str++;
+		++len;
+	}
+	for ( ; len < width; ++len) *buff++ = ' ';
+	*buff = '\0';
+	return buff;
+}
+
+// Start the CPU cycle counter of DWT unit, used to profile the code
+void cycleCounterInit(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT	= 0;
+	DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t cycleCounter(void) {
+	return DWT->CYCCNT;
+}
+
+uint32_t cyclesToUs(uint32_t cycles) {
+	return cycles / (SystemCoreClock / 1000000);
+}
@@ -7,8 +7,14 @@
 
 #include "unit.h"
 
-void UNIT::init(uint8_t c_len, uint16_t c_min, uint16_t c_max, uint8_t s_len, uint16_t s_min, uint16_t s_max) {
-	current.init(c_len,	c_min,	c_max);
+/*
+ * c_confirm - the number of the current readings in a row to change the connectivity status immediately,
+ * see SWITCH::update(). Zero means the status follows the average current only
+ */
+void UNIT::init(uint8_t c_len, uint16_t c_min, uint16_t c_max, uint8_t s_len, uint16_t s_min, uint16_t s_max, uint8_t c_confirm) {
+	current.init(c_len,	c_min,	c_max, c_confirm);
+	c_samples	= 0;
+	c_settle	= c_confirm?c_confirm:c_len + 1;
 	sw.init(s_len,		s_min, 	s_max);
 }
 
@@ -0,0 +1,170 @@
+/*
+ * usage.cpp
+ *
+ */
+
+#include <string.h>
+#include "usage.h"
+#include "tools.h"
+
+void USAGE::init(CFG *pCFG) {
+	STATS last;
+	if (pCFG->loadLastStats(&last)) {
+		gun_sec		= last.gun_sec;
+		gun_cycles	= last.gun_cycles;
+	}
+	loadTip(pCFG, pCFG->ironTipIndex());
+	loaded = true;
+}
+
+// Load the totals of the tip or start from zero if the tip has no statistics yet
+void USAGE::loadTip(CFG *pCFG, uint8_t tip_index) {
+	if (!pCFG->loadStats(&tip, tip_index) || tip.tip != tip_index) {
+		memset(&tip, 0, sizeof(STATS));
+		tip.tip = tip_index;
+	}
+	hold_avg.preset(tip.hold);
+}
+
+// The holding power is saved together with the totals, it does not initiate the EEPROM write
+void USAGE::holdPower(uint16_t power, int16_t delta) {
+	if (!loaded || delta < min_delta) return;
+	uint16_t h = ((uint32_t)power * 100 + (delta >> 1)) / delta;
+	if (tip.base_n < base_samples) {						// Build the baseline of the fresh tip
+		++tip.base_n;
+		tip.base_hold	= ((int32_t)tip.base_hold * (tip.base_n - 1) + h + (tip.base_n >> 1)) / tip.base_n;
+		hold_avg.preset(tip.base_hold);
+	} else {
+		hold_avg.update(h);
+	}
+	tip.hold = hold_avg.read();
+}
+
+// The tip is worn out (0%) when it requires 50% more power than the fresh one
+int8_t USAGE::health(void) {
+	if (tip.base_n < base_samples || tip.base_hold == 0) return -1;
+	int32_t drift = (int32_t)tip.hold - tip.base_hold;
+	return constrain(100 - drift * 200 / tip.base_hold, 0, 100);
+}
+
+// The signature is saved together with the totals, it does not initiate the EEPROM write
+void USAGE::heatSignature(uint16_t rise, uint8_t early) {
+	if (!loaded || rise == 0) return;
+	if (tip.sig_n < sig_samples) ++tip.sig_n;
+	uint8_t n	= tip.sig_n;
+	tip.rise	= ((uint32_t)tip.rise  * (n - 1) + rise  + (n >> 1)) / n;
+	tip.early	= ((uint16_t)tip.early * (n - 1) + early + (n >> 1)) / n;
+}
+
+// The actual totals of the current tip are in RAM, the EEPROM record can be outdated
+bool USAGE::loadSignature(CFG *pCFG, uint8_t n, STATS *st) {
+	if (!pCFG->loadStatsRecord(st, n)) return false;
+	if (st->tip == tip.tip) *st = tip;
+	uint8_t mask = pCFG->tipMask(st->tip);
+	return st->sig_n > 0 && st->rise > 0 && (mask & TIP_ACTIVE) && (mask & TIP_CALIBRATED);
+}
+
+bool USAGE::canIdentify(CFG *pCFG) {
+	if (!loaded) return false;
+	STATS st;
+	for (uint8_t n = 0; n < pCFG->statsTotal(); ++n) {
+		if (loadSignature(pCFG, n, &st)) return true;
+	}
+	return false;
+}
+
+/*
+ * The difference of the signatures is the relative difference of the rise plus the half of the relative difference
+ * of the early rise, percent. The tip with the smallest difference is identified if the difference is less than match_limit
+ */
+int16_t USAGE::identify(CFG *pCFG, uint16_t rise, uint8_t early) {
+	if (!loaded || rise == 0) return -1;
+	int16_t		best	= -1;
+	uint32_t	best_d	= match_limit;
+	STATS st;
+	for (uint8_t n = 0; n < pCFG->statsTotal(); ++n) {
+		if (!loadSignature(pCFG, n, &st)) continue;
+		uint32_t d = (uint32_t)abs(rise - st.rise) * 100 / st.rise;
+		d += (uint32_t)abs(early - st.early) * 50 / (st.early + early_floor);
+		if (d < best_d) {
+			best_d	= d;
+			best	= st.tip;
+		}
+	}
+	return best;
+}
+
+void USAGE::cycle(bool iron_on, uint16_t iron_pwm, bool gun_on) {
+	if (iron_on) {
+		c_iron_ms	+= cycle_ms;
+		c_pwm		+= iron_pwm;
+		if (!iron_was_on) ++c_iron_cycles;
+	}
+	if (gun_on) {
+		c_gun_ms	+= cycle_ms;
+		if (!gun_was_on) ++c_gun_cycles;
+	}
+	iron_was_on	= iron_on;
+	gun_was_on	= gun_on;
+}
+
+// Move the data accumulated by the interrupt handler to the totals
+void USAGE::collect(void) {
+	__disable_irq();
+	uint32_t	i_ms	= c_iron_ms;
+	uint32_t	g_ms	= c_gun_ms;
+	uint32_t	pwm		= c_pwm;
+	uint16_t	i_cyc	= c_iron_cycles;
+	uint16_t	g_cyc	= c_gun_cycles;
+	c_iron_ms = c_gun_ms = c_pwm = 0;
+	c_iron_cycles = c_gun_cycles = 0;
+	__enable_irq();
+
+	if (i_ms == 0 && g_ms == 0 && i_cyc == 0 && g_cyc == 0) return;
+	iron_ms			+= i_ms;
+	gun_ms			+= g_ms;
+	tip.iron_sec	+= iron_ms / 1000;
+	iron_ms			%= 1000;
+	gun_sec			+= gun_ms / 1000;
+	gun_ms			%= 1000;
+	energy_rest		+= (uint64_t)pwm * iron_watts * cycle_ms;
+	const uint32_t	joule = (uint32_t)pwm_full * 1000;
+	tip.iron_energy	+= energy_rest / joule;
+	energy_rest		%= joule;
+	tip.iron_cycles	+= i_cyc;
+	gun_cycles		+= g_cyc;
+	unsaved_ms		+= (i_ms > g_ms)?i_ms:g_ms;
+	dirty			= true;
+}
+
+void USAGE::save(CFG *pCFG) {
+	tip.gun_sec		= gun_sec;
+	tip.gun_cycles	= gun_cycles;
+	if (pCFG->saveStats(&tip)) {
+		dirty		= false;
+		unsaved_ms	= 0;
+	}
+}
+
+/*
+ * Save the totals when the working time since last save is big enough or a new heat cycle was finished,
+ * so the EEPROM is written rarely. Save the totals of the previous tip when the tip was changed.
+ * When the AC power is lost, save the data and write the EEPROM immediately
+ */
+void USAGE::update(CFG *pCFG, bool power_lost) {
+	if (!loaded) return;
+	collect();
+	uint8_t	tip_index = pCFG->ironTipIndex();
+	if (tip_index != tip.tip) {
+		if (dirty) save(pCFG);
+		loadTip(pCFG, tip_index);
+		return;
+	}
+	if (!dirty) return;
+	if (power_lost) {
+		save(pCFG);
+		pCFG->writeBack(true);
+	} else if (unsaved_ms >= save_period) {
+		save(pCFG);
+	}
+}
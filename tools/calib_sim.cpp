@@ -0,0 +1,110 @@
+/*
+ * calib_sim.cpp
+ *
+ *  Host simulation of the automatic tip calibration point (MCALIB::loop(), Src/mode.cpp).
+ *  The tip temperature (internal units) approaches the preset temperature exponentially with the time constant tau
+ *  plus the uniform noise. Every control cycle (20 ms) the temperature is saved by the settled detector and by the long
+ *  approach window as IRON does (Src/iron.cpp). The main loop accepts the predicted temperature when predict_confirm
+ *  predictions on new approach samples agree within the tolerance, the same way as MCALIB does, or the settled temperature.
+ *  For every approach the time of the predicted and of the settled temperature are shown, and the temperature of the tip
+ *  when the prediction was ready: the real temperature the user reads at this time is lower than the final one,
+ *  so the user is asked for the real temperature again when the temperature settles.
+ *  The predicted temperature should not differ from the final one by more than the tolerance.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/calib_sim.cpp tools/host/host.cpp Src/stat.cpp Src/tools.cpp -o calib_sim
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stat.h"
+
+static const uint16_t	cycle_ms			= 20;			// The control cycle period
+static const uint8_t	approach_decimation	= 32;			// See iron.h
+static const uint8_t	predict_confirm		= 6;			// See MCALIB in mode.h
+static const uint16_t	settle_tolerance	= 8;
+static const uint8_t	settle_confidence	= 20;
+static const uint32_t	max_ms				= 60000;		// Give up the approach after this time
+
+typedef struct s_result {
+	uint32_t	predict_ms;									// The time the predicted temperature is ready or 0
+	uint32_t	settle_ms;									// The time the temperature settled or 0
+	int32_t		error;										// The predicted temperature - the final one
+	int32_t		lag;										// The final temperature - the tip temperature when the prediction is ready
+} RESULT;
+
+static RESULT approach(double tau_s, int16_t noise, int32_t from, int32_t target) {
+	SETTLE	settle;
+	SETTLE	predictor(approach_decimation);
+	RESULT	r			= { 0, 0, 0, 0 };
+	int32_t	predicted	= 0;
+	uint8_t	confirmed	= 0;
+	uint16_t last_sample = 0;
+	for (uint32_t ms = cycle_ms; ms <= max_ms; ms += cycle_ms) {
+		double	t	= target - (target - from) * exp(-(double)ms / (tau_s * 1000.0));
+		int32_t	temp = lround(t) + (noise?(rand() % (2 * noise + 1) - noise):0);
+		settle.update(temp);
+		predictor.update(temp);
+		if (settle.settled(target, settle_tolerance, settle_confidence)) {
+			r.settle_ms = ms;
+			return r;
+		}
+		if (r.predict_ms || predictor.samples() == last_sample) continue;
+		last_sample = predictor.samples();
+		int32_t		final;
+		uint16_t	bound;
+		if (predictor.predict(&final, &bound) && bound <= settle_tolerance &&
+				(confirmed == 0 || abs(final - predicted) <= settle_tolerance)) {
+			if (confirmed == 0) predicted = final;
+			if (++confirmed >= predict_confirm) {
+				r.predict_ms	= ms;
+				r.error			= predicted - target;
+				r.lag			= target - lround(t);
+			}
+		} else {
+			predicted	= 0;
+			confirmed	= 0;
+		}
+	}
+	return r;
+}
+
+int main(void) {
+	const double	taus[]		= { 2.0, 4.0, 6.0 };
+	const int16_t	noises[]	= { 0, 2, 4 };
+	const uint16_t	runs		= 50;
+	uint32_t		bad			= 0;
+	srand(1);
+	printf("tau  noise  predicted  mean time  settled time  worst error  lag at prediction\n");
+	for (uint8_t i = 0; i < sizeof(taus) / sizeof(taus[0]); ++i) {
+		for (uint8_t j = 0; j < sizeof(noises) / sizeof(noises[0]); ++j) {
+			uint32_t	n_pred = 0, n_settle = 0;
+			double		pred_ms = 0, settle_ms = 0;
+			int32_t		worst = 0, lag = 0;
+			for (uint16_t run = 0; run < runs; ++run) {
+				int32_t from	= 900 + rand() % 200;
+				int32_t target	= from + 150 + rand() % 150;		// The next reference point
+				RESULT	r		= approach(taus[i], noises[j], from, target);
+				if (r.predict_ms) {
+					++n_pred;
+					pred_ms += r.predict_ms;
+					if (abs(r.error) > abs(worst)) worst = r.error;
+					if (r.lag > lag) lag = r.lag;
+					if (abs(r.error) > settle_tolerance) ++bad;
+				}
+				if (r.settle_ms) {
+					++n_settle;
+					settle_ms += r.settle_ms;
+				}
+			}
+			printf("%3.0fs  +/-%d  %6d/%d  %8.1fs  %11.1fs  %11d  %17d\n", taus[i], noises[j], n_pred, runs,
+					n_pred?pred_ms / n_pred / 1000:0, n_settle?settle_ms / n_settle / 1000:0, worst, lag);
+		}
+	}
+	if (bad) {
+		printf("%u predictions beyond the tolerance %d\n", bad, settle_tolerance);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * curve_test.cpp
+ *
+ *  Host test of the fitted tip calibration curve (TIP_CFG::tempCelsius(), Src/config.cpp).
+ *  The random calibration-like data sets are fitted by POLYFIT with the degree used by MCALIB::calibrationOLS(),
+ *  the curve is saved as four reference points. The tip with TIP_CURVE flag should translate the internal temperature
+ *  of the fitted curve back to the Celsius temperature everywhere between 200 and 400 Celsius, the curve value
+ *  in the translated temperature should not differ from the internal temperature by more than one unit
+ *  (the rounding of the saved points; where the curve is flat one unit is more than one Celsius degree)
+ *  or the temperature should not differ by more than one degree.
+ *  The same points without the flag (piecewise linear table) are checked for comparison.
+ *
+ *  Only TIP_CFG class of Src/config.cpp is used, drop the unused CFG functions by the linker:
+ *  g++ -O2 -Itools/host -IInc -IDrivers/u8g2/Inc -ffunction-sections -fdata-sections -Wl,--gc-sections
+ *  	tools/curve_test.cpp tools/host/host.cpp Src/config.cpp Src/stat.cpp Src/tools.cpp Src/vars.cpp -o curve_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "stat.h"
+
+#define MCALIB_POINTS	(8)									// The maximum number of the calibration points, see mode.h
+
+static const uint16_t	ref_temp[4]	= { 200, 260, 330, 400 };	// The IRON reference temperatures, see TIP_CFG
+
+// The same as MCALIB::calibrationOLS(): the curve values in the reference points, the degree or 0 if not monotonic
+static uint8_t sample(POLYFIT &curve, uint16_t tip[4]) {
+	for (uint8_t i = 0; i < 4; ++i) {
+		int32_t temp = curve.value(ref_temp[i]);
+		tip[i] = (temp < 0)?0:(temp > int_temp_max)?int_temp_max:temp;
+		if (i > 0 && tip[i] <= tip[i-1]) return 0;
+	}
+	int32_t prev = tip[0];
+	for (uint16_t t = ref_temp[0] + 5; t <= ref_temp[3]; t += 5) {
+		int32_t temp = curve.value(t);
+		if (temp <= prev) return 0;
+		prev = temp;
+	}
+	return curve.degree();
+}
+
+int main(void) {
+	TIP_CFG		cfg;
+	TIP			tip;
+	uint32_t	curves = 0, bad = 0;
+	int32_t		worst_curve = 0, worst_linear = 0;			// Celsius
+	int32_t		worst_units = 0, worst_units_linear = 0;	// The internal units
+	const int16_t ambient = 25;
+	cfg.activateGun(false);
+	srand(1);
+	for (uint16_t trial = 0; trial < 5000; ++trial) {
+		uint8_t n = 5 + rand() % (MCALIB_POINTS - 4);		// 5 points and more: quadratic or cubic curve
+		uint16_t x[POLY_MAX_POINTS], y[POLY_MAX_POINTS];
+		double a0 = 300 + rand() % 600;
+		double a1 = 1 + (rand() % 150) / 100.0;
+		double a2 = (rand() % 200 - 100) / 1e4;
+		double a3 = (rand() % 200 - 100) / 1e6;
+		for (uint8_t i = 0; i < n; ++i) {
+			x[i] = 150 + i * 300 / (n-1) + rand() % 21 - 10;	// The calibration covers the reference points, see MCALIB
+			double X = x[i] - 300.0;
+			double Y = a0 + a1 * X + a2 * X * X + a3 * X * X * X + (rand() % 21 - 10);
+			y[i] = (Y < 0)?0:(Y > 4095)?4095:(uint16_t)Y;
+		}
+		POLYFIT		curve;
+		uint16_t	t[4];
+		uint8_t		degree = (n >= 6)?3:2;
+		if (!curve.fit(x, y, n, degree) || sample(curve, t) < 2) continue;
+		++curves;
+		memset(&tip, 0, sizeof(TIP));
+		tip.t200 = t[0]; tip.t260 = t[1]; tip.t330 = t[2]; tip.t400 = t[3];
+		tip.ambient	= ambient;
+		for (uint8_t pass = 0; pass < 2; ++pass) {
+			tip.mask = TIP_ACTIVE | TIP_CALIBRATED | (pass?0:TIP_CURVE);
+			cfg.load(tip);
+			for (uint16_t temp = ref_temp[0]; temp <= ref_temp[3]; ++temp) {
+				int32_t	 internal	= curve.value(temp);
+				uint16_t h			= cfg.tempCelsius(internal, ambient, DEV_IRON);
+				int32_t	 e			= abs((int32_t)h - temp);
+				int32_t	 u			= abs(curve.value(h) - internal);
+				if (pass) {
+					if (e > worst_linear)		worst_linear		= e;
+					if (u > worst_units_linear)	worst_units_linear	= u;
+					continue;
+				}
+				if (e > worst_curve) worst_curve = e;
+				if (u > worst_units) worst_units = u;
+				if (e > 1 && u > 2) {
+					if (bad < 5) printf("points %d degree %d: %d Celsius translated as %d\n", n, degree, temp, h);
+					++bad;
+				}
+			}
+		}
+	}
+	printf("%u curves, the worst error: TIP_CURVE %d Celsius (%d units), linear table %d Celsius (%d units), errors: %u\n",
+			curves, worst_curve, worst_units, worst_linear, worst_units_linear, bad);
+	return bad?1:0;
+}
@@ -0,0 +1,112 @@
+/*
+ * digit_bench.cpp
+ *
+ *  Host check and benchmark of the large digits cache of DSPL (Src/display.cpp).
+ *  Every digit of u8g2_font_kam28n drawn from the cache by drawDigits() should give exactly the same frame buffer
+ *  as u8g2_DrawGlyph() for every pen position on the screen, both display rotations used by the cache,
+ *  both font modes and different background. Then the time to draw the main screen temperature is measured.
+ *  The time on the PC shows the ratio only, use cycleCounter() to profile the code on the controller.
+ *
+ *  The u8g2 library is C code, build it separately:
+ *  gcc -c -O2 -IDrivers/u8g2/Inc Drivers/u8g2/Src/u8*.c Src/font.c
+ *  g++ -O2 -Itools/host -IInc -IDrivers/u8g2/Inc -ffunction-sections -fdata-sections -Wl,--gc-sections
+ *  	tools/digit_bench.cpp tools/host/host.cpp Src/display.cpp Src/tools.cpp Src/swtimer.cpp *.o -o digit_bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#define private public										// The digit cache functions are private members of DSPL
+#include "display.h"
+#undef private
+
+// The display driver and I2C bus functions, the display is not connected
+I2C_HandleTypeDef	hi2c1;
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t addr, uint32_t trials, uint32_t timeout) {
+	return HAL_ERROR;
+}
+
+extern "C" uint8_t u8x8_gpio_and_delay_stm32(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+	return 1;
+}
+
+extern "C" uint8_t u8x8_byte_stm32_hw_spi(u8x8_t *u8g2, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+	return 1;
+}
+
+extern "C" uint8_t u8x8_byte_stm32_hw_i2c(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+	return 1;
+}
+
+static DSPL		dspl;
+static uint8_t	ref[d_width*d_height/8];
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end) {
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static void fillBackground(uint8_t *buff, uint8_t bg) {
+	for (uint16_t i = 0; i < d_width*d_height/8; ++i)
+		buff[i] = (bg == 2)?(uint8_t)(i * 37 + (i >> 7)):(bg?0xFF:0);
+}
+
+// Returns the number of mismatched frames
+static uint32_t check(const u8g2_cb_t *rotation, const char *name) {
+	u8g2_t		*u8g2	= dspl.getU8g2();
+	uint8_t		*buff	= dspl.getBufferPtr();
+	uint32_t	frames	= 0;
+	uint32_t	bad		= 0;
+	dspl.setDisplayRotation(rotation);
+	dspl.buildDigitCache();
+	if (!dspl.digit_cache_ok) {
+		printf("%s: the digit cache is not built\n", name);
+		return 1;
+	}
+	dspl.setFont(u8g2_font_kam28n);
+	dspl.setDrawColor(1);
+	for (uint8_t mode = 0; mode < 2; ++mode) {				// Solid and transparent font mode
+		dspl.setFontMode(mode);
+		for (uint8_t bg = 0; bg < 3; ++bg) {
+			for (uint8_t d = 0; d < 10; ++d) {
+				char str[2] = { (char)('0' + d), '\0' };
+				for (int16_t y = 0; y < d_height + 32; ++y) {
+					for (int16_t x = 0; x < d_width; ++x) {
+						fillBackground(buff, bg);
+						u8g2_DrawGlyph(u8g2, x, y, '0' + d);
+						memcpy(ref, buff, sizeof(ref));
+						fillBackground(buff, bg);
+						dspl.drawDigits(x, y, str);
+						++frames;
+						if (memcmp(ref, buff, sizeof(ref))) {
+							if (bad < 5) printf("%s: digit %d at (%d, %d), font mode %d, background %d differs\n", name, d, x, y, mode, bg);
+							++bad;
+						}
+					}
+				}
+			}
+		}
+	}
+	printf("%s: %u frames checked, mismatches %u\n", name, frames, bad);
+	return bad;
+}
+
+int main(void) {
+	dspl.init();
+	uint32_t bad = check(U8G2_R2, "U8G2_R2") + check(U8G2_R0, "U8G2_R0");
+
+	// The main screen temperature, see DSPL::mainShow()
+	const uint32_t	calls	= 200000;
+	dspl.setDisplayRotation(U8G2_R2);
+	dspl.buildDigitCache();
+	dspl.setFont(u8g2_font_kam28n);
+	dspl.setFontMode(0);
+	struct timespec t0, t1, t2;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < calls; ++i) dspl.drawStr(30, 42, "235");
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (uint32_t i = 0; i < calls; ++i) dspl.drawDigits(30, 42, "235");
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	printf("\"235\": u8g2_DrawStr() %.2f us, drawDigits() %.2f us\n", elapsedNs(t0, t1) / calls / 1000, elapsedNs(t1, t2) / calls / 1000);
+	return bad?1:0;
+}
@@ -0,0 +1,217 @@
+/*
+ * eeprom_test.cpp
+ *
+ *  Host test of EEPROM class (Src/eeprom.cpp) over the emulated at24c32a IC.
+ *  The tip area is read through the tip cache: the tip change should read the EEPROM IC only when the chunk
+ *  is not cached, the saved tip should be written through to the IC and forceReloadChunk() should read the IC again.
+ *  The IC filled by the old firmware, that wrote the configuration records into the chunks 0-63, should load the newest
+ *  configuration record and keep it in the configuration area, the second boot should not write anything.
+ *  The statistics area keeps 16 tips, the 17-th tip should overwrite the tip saved least recently and report it.
+ *
+ *  g++ -O2 -Itools/host -IInc -IDrivers/u8g2/Inc tools/eeprom_test.cpp tools/host/host.cpp Src/eeprom.cpp Src/swtimer.cpp -o eeprom_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#define private public										// The checksum functions are private members of EEPROM
+#include "eeprom.h"
+#undef private
+
+static uint8_t	ic[4096];									// The emulated EEPROM IC
+static uint32_t	ic_reads	= 0;
+static uint32_t	ic_writes	= 0;
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t addr, uint32_t trials, uint32_t timeout) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t addr, uint16_t mem_addr, uint16_t mem_size,
+		uint8_t *data, uint16_t size, uint32_t timeout) {
+	if (mem_addr + size > (uint16_t)sizeof(ic)) return HAL_ERROR;
+	memcpy(data, &ic[mem_addr], size);
+	++ic_reads;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t addr, uint16_t mem_addr, uint16_t mem_size,
+		uint8_t *data, uint16_t size, uint32_t timeout) {
+	if (mem_addr + size > (uint16_t)sizeof(ic)) return HAL_ERROR;
+	memcpy(&ic[mem_addr], data, size);
+	++ic_writes;
+	return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c) {
+	return HAL_I2C_STATE_READY;
+}
+
+void HAL_Delay(uint32_t delay) {
+	host_tick += delay;
+}
+
+void oledWait(void) { }
+
+static uint32_t	errors	= 0;
+
+static void check(bool ok, const char *what) {
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++errors;
+	}
+}
+
+static void makeTip(TIP *tip, uint8_t n) {
+	memset(tip, 0, sizeof(TIP));
+	tip->t200	= 1000 + n;
+	tip->t260	= 1200 + n;
+	tip->t330	= 1400 + n;
+	tip->t400	= 1600 + n;
+	tip->mask	= 3;
+	snprintf(tip->name, sizeof(tip->name), "T%d", n);
+}
+
+// The tip records in the tip area are loaded several times, the IC is read once per chunk until the cache is full
+static void testTipCache(void) {
+	I2C_HandleTypeDef	hi2c;
+	EEPROM				eeprom(&hi2c);
+	TIP					tip, read_tip;
+
+	memset(ic, 0xFF, sizeof(ic));
+	check(eeprom.init(), "init");
+	const uint8_t tips = eeprom_tip_cache * 2;				// Two tip records per chunk
+	for (uint8_t i = 0; i < tips; ++i) {
+		makeTip(&tip, i);
+		check(eeprom.saveTipData(&tip, i) == EPR_OK, "save tip");
+	}
+	uint32_t w = ic_writes;
+	eeprom.writeBack(true);
+	check(ic_writes == w, "the tip chunks are written through");
+
+	uint32_t r = ic_reads;
+	for (uint8_t pass = 0; pass < 10; ++pass) {
+		for (uint8_t i = 0; i < tips; ++i) {
+			check(eeprom.loadTipData(&read_tip, i) == EPR_OK, "load tip");
+			makeTip(&tip, i);
+			check(read_tip.t330 == tip.t330 && strcmp(read_tip.name, tip.name) == 0, "loaded tip data");
+		}
+	}
+	printf("%d tips loaded 10 times: %u IC reads\n", tips, ic_reads - r);
+	check(ic_reads == r, "the cached tip chunks are not read from the IC");
+
+	// The written tip is visible in the IC
+	makeTip(&tip, 100);
+	check(eeprom.saveTipData(&tip, 3) == EPR_OK, "save tip again");
+	uint8_t *rec = &ic[(eeprom_mirror_chunks + 1) * eeprom_chunk_size + eeprom_chunk_size / 2];	// The second record of the chunk
+	memcpy(&read_tip, rec, sizeof(TIP));
+	check(read_tip.t200 == tip.t200, "the tip is written to the IC");
+
+	// forceReloadChunk() reads the IC
+	rec[offsetof(TIP, crc)] ^= 0x55;						// Corrupt the record in the IC
+	eeprom.forceReloadChunk();
+	r = ic_reads;
+	check(eeprom.loadTipData(&read_tip, 3) == EPR_CHECKSUM, "the reloaded chunk is checked");
+	check(ic_reads == r + 1, "forceReloadChunk() reads the IC");
+
+	// The next chunk is not cached, it replaces the oldest cache slot
+	makeTip(&tip, eeprom_tip_cache * 2);
+	eeprom.saveTipData(&tip, eeprom_tip_cache * 2);
+	r = ic_reads;
+	eeprom.loadTipData(&read_tip, eeprom_tip_cache * 2);
+	check(ic_reads == r && read_tip.t200 == tip.t200, "the new chunk is cached");
+}
+
+// Write the configuration record with the ID into the chunk of the IC as the old firmware did
+static void putRecord(EEPROM *eeprom, uint16_t chunk, uint32_t id) {
+	RECORD rec;
+	memset(&rec, 0x5A, sizeof(RECORD));
+	rec.ID = id;
+	eeprom->CFG_checkSum(&rec, true);
+	memcpy(&ic[chunk * eeprom_chunk_size], &rec, sizeof(RECORD));
+}
+
+static uint16_t oldRecordsLeft(EEPROM *eeprom) {
+	uint16_t left = 0;
+	for (uint16_t chunk = eeprom->stat_first; chunk < eeprom->stat_first + eeprom->stat_chunks; ++chunk) {
+		RECORD rec;
+		memcpy(&rec, &ic[chunk * eeprom_chunk_size], sizeof(RECORD));
+		if (eeprom->CFG_checkSum(&rec, false)) ++left;
+	}
+	return left;
+}
+
+// The configuration records of the old firmware in the statistics area
+static void testUpgrade(void) {
+	I2C_HandleTypeDef	hi2c;
+	const uint16_t		saved[] = { 20, 48, 49, 55, 64, 100, 130 };	// The number of records saved by the old firmware
+	for (uint8_t i = 0; i < sizeof(saved) / sizeof(saved[0]); ++i) {
+		memset(ic, 0xFF, sizeof(ic));
+		EEPROM	old(&hi2c);
+		for (uint32_t id = 1; id <= saved[i]; ++id)
+			putRecord(&old, (id - 1) % 64, id);
+
+		EEPROM	eeprom(&hi2c);
+		RECORD	rec;
+		check(eeprom.init(), "init after upgrade");
+		bool ok = eeprom.loadRecord(&rec);
+		uint16_t left = oldRecordsLeft(&eeprom);
+		uint32_t w = ic_writes;
+		EEPROM	reboot(&hi2c);
+		RECORD	rec2;
+		reboot.init();
+		bool ok2 = reboot.loadRecord(&rec2);
+		printf("%3d old records: loaded ID %u, left in the statistics area %d, reboot ID %u, writes %u\n",
+				saved[i], rec.ID, left, rec2.ID, ic_writes - w);
+		check(ok && rec.ID == saved[i], "the newest configuration record is loaded");
+		check(left == 0, "the old records are removed from the statistics area");
+		check(ok2 && rec2.ID == saved[i] && ic_writes == w, "the second boot does not write");
+
+		reboot.saveRecord(&rec2);
+		reboot.writeBack(true);
+		EEPROM	next(&hi2c);
+		next.init();
+		next.loadRecord(&rec);
+		check(rec.ID == saved[i] + 1u, "the saved record is loaded");
+	}
+}
+
+// Save the statistics of more tips than the area can keep
+static void testStatsFull(void) {
+	I2C_HandleTypeDef	hi2c;
+	EEPROM				eeprom(&hi2c);
+	STATS				st;
+	memset(ic, 0xFF, sizeof(ic));
+	check(eeprom.init(), "init");
+	const uint8_t tips = eeprom.statsTotal();
+	for (uint8_t pass = 0; pass < 3; ++pass) {				// Save every tip several times
+		for (uint8_t tip = 1; tip <= tips; ++tip) {
+			memset(&st, 0, sizeof(STATS));
+			st.tip		= tip;
+			st.iron_sec	= tip * 100 + pass;
+			check(eeprom.saveStats(&st), "save statistics");
+		}
+	}
+	check(eeprom.droppedStats() < 0, "no statistics are dropped while the area is not full");
+	memset(&st, 0, sizeof(STATS));
+	st.tip = tips + 1;
+	check(eeprom.saveStats(&st), "save the statistics of the extra tip");
+	printf("%d tips saved 3 times, the tip %d overwrites the statistics of the tip %d\n", tips, tips + 1, eeprom.droppedStats());
+	check(eeprom.droppedStats() == 1, "the tip saved least recently is dropped");
+	check(!eeprom.loadStats(&st, 1), "the dropped tip has no statistics");
+	for (uint8_t tip = 2; tip <= tips + 1; ++tip) {
+		bool ok = eeprom.loadStats(&st, tip) && st.tip == tip;
+		check(ok && (tip > tips || st.iron_sec == tip * 100u + 2), "the other tips are kept");
+	}
+}
+
+int main(void) {
+	testTipCache();
+	testUpgrade();
+	testStatsFull();
+	if (errors) {
+		printf("%u errors\n", errors);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
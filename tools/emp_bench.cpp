@@ -0,0 +1,51 @@
+/*
+ * emp_bench.cpp
+ *
+ *  Host check and microbenchmark of EMP<K> against EMP_AVERAGE (Src/stat.cpp). For every coefficient used
+ *  by the firmware filters both averages are fed by the same random samples (ADC readings and large values),
+ *  the results should be identical. Then the time of one average() call is measured for both classes.
+ *  The time on the PC shows the ratio only, use cycleCounter() to profile the code on the controller.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/emp_bench.cpp tools/host/host.cpp Src/stat.cpp Src/tools.cpp -o emp_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stat.h"
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end) {
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+// Returns the number of mismatches
+template <uint8_t K> uint32_t run(void) {
+	const uint32_t	samples	= 2000000;
+	const uint32_t	calls	= 50000000;
+	EMP_AVERAGE		a(K);
+	EMP<K>			b;
+	uint32_t		bad		= 0;
+	for (uint32_t i = 0; i < samples; ++i) {
+		int32_t v = rand() % 4096;							// 12-bit ADC reading
+		if (i % 3 == 0) v = rand() % 200000;				// Power, dispersion
+		if (a.average(v) != b.average(v)) ++bad;
+	}
+
+	volatile int32_t sink = 0;
+	struct timespec t0, t1, t2;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < calls; ++i) sink = a.average(i & 4095);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (uint32_t i = 0; i < calls; ++i) sink = b.average(i & 4095);
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	(void)sink;
+	printf("K = %3d: mismatches %u, EMP_AVERAGE %.2f ns, EMP<K> %.2f ns\n",
+			K, bad, elapsedNs(t0, t1) / calls, elapsedNs(t1, t2) / calls);
+	return bad;
+}
+
+int main(void) {
+	srand(1);
+	uint32_t bad = run<5>() + run<8>() + run<10>() + run<20>() + run<32>() + run<200>();
+	return bad?1:0;
+}
@@ -0,0 +1,147 @@
+/*
+ * encoder_replay.cpp
+ *
+ *  Host replay of the encoder channel edges through RENC::quadrature() (Src/encoder.cpp).
+ *  The edge traces are generated from the mechanical encoder model: four quarter steps per detent,
+ *  the contact bounce toggles the changing channel several times, the lost edge is the channel change
+ *  that the interrupt did not see because the next edge came before the channels were read (the next reading
+ *  has both channels changed). The last edge of the rotation is never lost: its interrupt reads the final state.
+ *  There should be no missed or double counted detents for the bounce and for one lost edge per detent,
+ *  the acceleration should depend on the rotation speed only.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/encoder_replay.cpp tools/host/host.cpp Src/encoder.cpp -o encoder_replay
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "encoder.h"
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin) {
+	return GPIO_PIN_SET;									// The channels are replayed by quadrature(), the button is released
+}
+
+static GPIO_TypeDef	port_a, port_b;
+static const uint8_t cw[4] = { 1, 0, 2, 3 };				// The channel states of one detent forward from the rest state 3
+
+typedef struct s_trace {
+	uint8_t		ab[8192];
+	uint32_t	t[8192];
+	uint16_t	len;
+} TRACE;
+
+static void edge(TRACE *tr, uint8_t ab, uint32_t t) {
+	if (tr->len < sizeof(tr->ab)) {
+		tr->ab[tr->len]	= ab;
+		tr->t[tr->len]	= t;
+		++tr->len;
+	}
+}
+
+/*
+ * Build the trace of the detents rotated in the dir direction with the interval in ms between the detents.
+ * bounce - the maximum number of extra toggles of the changing channel, lost - the probability (%) to lose one edge of the detent
+ */
+static void build(TRACE *tr, uint16_t detents, int8_t dir, uint32_t *now, uint16_t interval, uint8_t bounce, uint8_t lost) {
+	bool prev_lost = false;									// The last edge of the previous detent was lost
+	for (uint16_t d = 0; d < detents; ++d) {
+		int8_t skip = (rand() % 100 < lost)?rand() % 4:-1;	// The lost edge of this detent
+		if (skip == 3 && d == detents - 1) skip = -1;		// The encoder stops in the rest state, see above
+		if (skip == 0 && prev_lost) skip = -1;				// Two edges in a row are lost, the direction is unknown
+		prev_lost = (skip == 3);
+		uint8_t prev = 3;
+		for (uint8_t q = 0; q < 4; ++q) {
+			uint8_t  ab	= (q == 3)?3:((dir > 0)?cw[q]:cw[2-q]);
+			uint32_t t	= *now + (uint32_t)interval * q / 4;
+			if (q == skip) {
+				prev = ab;
+				continue;
+			}
+			uint8_t n = bounce?rand() % (bounce + 1):0;
+			for (uint8_t b = 0; b < n; ++b) {				// The contact bounces between the previous and the new state
+				edge(tr, ab, t);
+				edge(tr, prev, t);
+			}
+			edge(tr, ab, t);
+			prev = ab;
+		}
+		*now += interval;
+	}
+}
+
+static void replay(RENC *enc, const TRACE *tr) {
+	for (uint16_t i = 0; i < tr->len; ++i)
+		enc->quadrature(tr->ab[i], tr->t[i]);
+}
+
+static uint32_t	errors	= 0;
+
+static void check(const char *name, int16_t pos, int16_t expected) {
+	printf("%-40s position %5d, expected %5d%s\n", name, pos, expected, (pos == expected)?"":"  FAILED");
+	if (pos != expected) ++errors;
+}
+
+// The slow rotation without the acceleration: every detent should be counted once
+static void countTest(const char *name, uint8_t bounce, uint8_t lost) {
+	static TRACE tr;
+	RENC		enc(&port_a, 0, &port_b, 1);
+	uint32_t	now		= 1000;
+	int16_t		expected	= 0;
+	enc.reset(0, -30000, 30000, 1, 1, true);				// The looped encoder does not accelerate
+	for (uint16_t run = 0; run < 200; ++run) {
+		tr.len = 0;
+		int8_t	 dir		= (rand() & 1)?1:-1;
+		uint16_t detents	= 1 + rand() % 20;
+		build(&tr, detents, dir, &now, 40 + rand() % 200, bounce, lost);
+		replay(&enc, &tr);
+		expected += dir * detents;
+		now += 500;
+	}
+	check(name, enc.read(), expected);
+}
+
+// The fast flick accelerates the encoder, the acceleration stops when the rotation is slow or reversed
+static void accelTest(void) {
+	static TRACE tr;
+	RENC		enc(&port_a, 0, &port_b, 1);
+	uint32_t	now		= 1000;
+
+	enc.reset(0, 0, 2000, 1, 1, false);
+	tr.len = 0;
+	build(&tr, 10, 1, &now, 200, 0, 0);					// Slow rotation, no acceleration
+	replay(&enc, &tr);
+	check("slow rotation, 10 detents", enc.read(), 10);
+
+	now += 1000;
+	tr.len = 0;
+	build(&tr, 30, 1, &now, 5, 2, 0);						// The fast flick with bounce: 5 ms between detents
+	replay(&enc, &tr);
+	// The averaged interval: 150 (x1), 78 (x1), 42 (x2), 24 (x5), then 15 ms and less (x10)
+	check("fast flick, 30 detents in 150 ms", enc.read(), 10 + 1 + 1 + 2 + 5 + 26 * 10);
+
+	tr.len = 0;
+	build(&tr, 3, -1, &now, 5, 0, 0);						// Reverse the flick: the acceleration starts again
+	replay(&enc, &tr);
+	check("reversed fast flick, 3 detents", enc.read(), 279 - 1 - 1 - 2);
+
+	now += 1000;
+	tr.len = 0;
+	build(&tr, 5, 1, &now, 100, 0, 0);						// Slow rotation after the pause
+	replay(&enc, &tr);
+	check("slow rotation after the flick", enc.read(), 275 + 5);
+}
+
+int main(void) {
+	srand(1);
+	countTest("clean edges", 0, 0);
+	countTest("bounce, up to 4 extra toggles per edge", 4, 0);
+	countTest("one lost edge in 50% of detents", 0, 50);
+	countTest("one lost edge in every detent", 0, 100);
+	countTest("bounce and lost edges", 3, 30);
+	accelTest();
+	if (errors) {
+		printf("%u errors\n", errors);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
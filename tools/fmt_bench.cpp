@@ -0,0 +1,85 @@
+/*
+ * fmt_bench.cpp
+ *
+ *  Host check and microbenchmark of fmtInt() and fmtStr() (Src/tools.cpp) against snprintf().
+ *  The output should be identical to "%*d", "%0*d" and "%-*s" for every width used by the firmware,
+ *  including INT32_MIN and INT32_MAX. Then the time of one call is measured for both ways.
+ *  The time on the PC shows the ratio only, use cycleCounter() to profile the code on the controller.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/fmt_bench.cpp tools/host/host.cpp Src/tools.cpp -o fmt_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "tools.h"
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end) {
+	return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static int32_t randValue(uint32_t i) {
+	static const int32_t edge[] = { 0, 1, -1, 9, -9, 10, -10, 99, 100, -100, 999999999, -999999999, INT32_MAX, INT32_MIN };
+	if (i < sizeof(edge) / sizeof(edge[0])) return edge[i];
+	switch (i % 4) {
+		case 0:	return rand() % 1000;						// The temperature, the power
+		case 1:	return rand() % 200 - 100;					// The ambient temperature, the PID coefficients
+		case 2:	return rand() % 100000;						// The time, the energy
+		default: return (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+	}
+}
+
+// Returns the number of mismatches
+static uint32_t check(void) {
+	char		a[32], b[32];
+	uint32_t	bad	= 0;
+	for (uint32_t i = 0; i < 1000000; ++i) {
+		int32_t v = randValue(i);
+		for (uint8_t width = 0; width <= 12; ++width) {
+			fmtInt(a, v, width);
+			snprintf(b, sizeof(b), "%*d", width, v);
+			if (strcmp(a, b)) ++bad;
+			fmtInt(a, v, width, '0');
+			snprintf(b, sizeof(b), "%0*d", width, v);
+			if (strcmp(a, b)) {
+				if (bad < 10) printf("%d, width %d: '%s' instead of '%s'\n", v, width, a, b);
+				++bad;
+			}
+		}
+	}
+	static const char *str[] = { "", "T12", "JL02", "Boost", "Temperature" };
+	for (uint8_t i = 0; i < sizeof(str) / sizeof(str[0]); ++i) {
+		for (uint8_t width = 0; width <= 12; ++width) {
+			fmtStr(a, str[i], width);
+			snprintf(b, sizeof(b), "%-*s", width, str[i]);
+			if (strcmp(a, b)) ++bad;
+		}
+	}
+	return bad;
+}
+
+int main(void) {
+	srand(1);
+	uint32_t bad = check();
+
+	const uint32_t	calls	= 20000000;
+	char			buff[32];
+	volatile char	sink	= 0;
+	struct timespec t0, t1, t2;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (uint32_t i = 0; i < calls; ++i) {
+		fmtInt(buff, i % 1000, 3);
+		sink = buff[0];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	for (uint32_t i = 0; i < calls; ++i) {
+		snprintf(buff, sizeof(buff), "%3d", i % 1000);
+		sink = buff[0];
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t2);
+	(void)sink;
+	printf("mismatches %u, fmtInt %.2f ns, snprintf %.2f ns\n", bad, elapsedNs(t0, t1) / calls, elapsedNs(t1, t2) / calls);
+	return bad?1:0;
+}
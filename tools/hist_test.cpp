@@ -0,0 +1,99 @@
+/*
+ * hist_test.cpp
+ *
+ *  Host test of HIST class (Src/stat.cpp) against the previous implementation that summed the queue
+ *  on every read() and dispersion() call. The running sums should give exactly the same results
+ *  for any history length, any values (including 32-bit overflow of the sum of squares) and after reset().
+ *
+ *  g++ -O2 -Itools/host -IInc tools/hist_test.cpp tools/host/host.cpp Src/stat.cpp Src/tools.cpp -o hist_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "stat.h"
+
+// The previous HIST implementation
+class OLD_HIST {
+	public:
+		OLD_HIST(uint8_t h_length = H_LENGTH)			{ len = index = 0; max_len = h_length; }
+		void			length(uint8_t h_length)		{ len = index = 0; if (h_length > H_LENGTH) h_length = H_LENGTH; max_len = h_length; }
+		void			reset()							{ len = index = 0; }
+		int32_t			read(void);
+		int32_t			average(int32_t value)			{ update(value); return read(); }
+		void			update(int32_t value);
+		uint32_t		dispersion(void);
+	private:
+		int32_t			queue[H_LENGTH];
+		uint8_t			len, max_len, index;
+};
+
+int32_t OLD_HIST::read(void) {
+	int32_t sum = 0;
+	if (len == 0) return 0;
+	if (len == 1) return queue[0];
+	for (uint8_t i = 0; i < len; ++i) sum += queue[i];
+	sum += len >> 1;										// round the average
+	sum /= len;
+	return sum;
+}
+
+void OLD_HIST::update(int32_t value) {
+	if (len < max_len) {
+		queue[len++] = value;
+	} else {
+		queue[index] = value;
+		if (++index >= max_len) index = 0;					// Use ring buffer
+	}
+}
+
+uint32_t OLD_HIST::dispersion(void) {
+	if (len < 3) return 1000;
+	uint32_t sum = 0;
+	uint32_t avg = read();
+	for (uint8_t i = 0; i < len; ++i) {
+		int32_t q = queue[i];
+		q -= avg;
+		q *= q;
+		sum += q;
+	}
+	sum += len >> 1;
+	sum /= len;
+	return sum;
+}
+
+int main(void) {
+	const int32_t ranges[] = { 10, 1000, 70000, 100000, 2000000000 };	// ADC readings, power, overflowing values
+	uint32_t checked = 0, mismatches = 0;
+	srand(5);
+	for (uint8_t r = 0; r < sizeof(ranges)/sizeof(ranges[0]); ++r) {
+		for (uint16_t trial = 0; trial < 2000; ++trial) {
+			uint8_t len = 1 + rand() % H_LENGTH;
+			HIST		h(len);
+			OLD_HIST	o(len);
+			if (trial % 3 == 0) {
+				h.length(len);
+				o.length(len);
+			}
+			for (uint8_t k = 0; k < 100; ++k) {
+				int32_t v = (int32_t)((int64_t)rand() % (2LL * ranges[r] + 1) - ranges[r]);
+				if (trial % 7 == 0) v = abs(v);				// Positive values only
+				if (k == 50 && trial % 5 == 0) {
+					h.reset();
+					o.reset();
+				}
+				int32_t		a	= h.average(v);
+				int32_t		b	= o.average(v);
+				uint32_t	da	= h.dispersion();
+				uint32_t	db	= o.dispersion();
+				++checked;
+				if (a != b || da != db) {
+					if (mismatches < 5)
+						printf("length %d value %d: average %d/%d dispersion %u/%u\n", len, v, a, b, da, db);
+					++mismatches;
+				}
+			}
+		}
+	}
+	printf("HIST: checked %u, mismatches %u\n", checked, mismatches);
+	return mismatches?1:0;
+}
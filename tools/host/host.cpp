@@ -0,0 +1,16 @@
+/*
+ * host.cpp
+ *
+ *  The hardware registers, variables and HAL functions of the firmware required to link tools.cpp and pid.cpp on the host
+ */
+
+#include "main.h"
+
+volatile uint32_t	host_tick	= 0;
+HOST_DWT		host_dwt;
+HOST_CORE_DEBUG	host_core_debug;
+uint32_t		SystemCoreClock	= 72000000;
+
+uint32_t HAL_GetTick(void) {
+	return host_tick;
+}
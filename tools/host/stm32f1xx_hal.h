@@ -0,0 +1,78 @@
+/*
+ * stm32f1xx_hal.h
+ *
+ *  Host replacement of the HAL header included by Inc/main.h to build the hardware independent modules
+ *  (stat.cpp, tools.cpp, telemetry.cpp, eeprom.cpp, encoder.cpp) on the PC for the tests in the tools directory.
+ *  Put this directory first in the include path:
+ *  	g++ -O2 -Itools/host -IInc ...
+ *  There are no interrupts on the host, the interrupt control functions do nothing
+ */
+
+#ifndef HOST_STM32F1XX_HAL_H_
+#define HOST_STM32F1XX_HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint32_t			Instance;
+} TIM_HandleTypeDef;										// Used by the main.h function prototype only
+
+typedef struct {
+	uint32_t			Instance;
+} SPI_HandleTypeDef;										// Used by the oled.h declarations only
+
+typedef struct {
+	uint32_t			Instance;
+} I2C_HandleTypeDef;
+
+typedef struct {
+	volatile uint32_t	IDR;
+} GPIO_TypeDef;
+
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+typedef enum { HAL_I2C_STATE_RESET = 0, HAL_I2C_STATE_READY = 0x20, HAL_I2C_STATE_BUSY = 0x24 } HAL_I2C_StateTypeDef;
+
+#define I2C_MEMADD_SIZE_16BIT			(0x10U)
+
+// The I2C functions used by eeprom.cpp are implemented by the test emulating the EEPROM IC
+HAL_StatusTypeDef		HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t addr, uint32_t trials, uint32_t timeout);
+HAL_StatusTypeDef		HAL_I2C_Mem_Read(I2C_HandleTypeDef *hi2c, uint16_t addr, uint16_t mem_addr, uint16_t mem_size,
+							uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef		HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t addr, uint16_t mem_addr, uint16_t mem_size,
+							uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_I2C_StateTypeDef	HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+void					HAL_Delay(uint32_t delay);
+GPIO_PinState			HAL_GPIO_ReadPin(GPIO_TypeDef *port, uint16_t pin);	// Implemented by the test
+
+static inline uint32_t	__get_PRIMASK(void)					{ return 0; }
+static inline void		__set_PRIMASK(uint32_t primask)		{ (void)primask; }
+static inline void		__disable_irq(void)					{ }
+static inline void		__enable_irq(void)					{ }
+static inline void		__DMB(void)							{ }
+
+// The cycle counter registers used by tools.cpp
+typedef struct {
+	volatile uint32_t	CTRL;
+	volatile uint32_t	CYCCNT;
+} HOST_DWT;
+
+typedef struct {
+	volatile uint32_t	DEMCR;
+} HOST_CORE_DEBUG;
+
+uint32_t				HAL_GetTick(void);					// Returns host_tick, the test can advance it
+
+extern volatile uint32_t	host_tick;
+extern HOST_DWT			host_dwt;
+extern HOST_CORE_DEBUG	host_core_debug;
+extern uint32_t			SystemCoreClock;
+
+#define DWT								(&host_dwt)
+#define CoreDebug						(&host_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk			(1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk		(1UL << 24)
+
+#endif
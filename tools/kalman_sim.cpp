@@ -0,0 +1,162 @@
+/*
+ * kalman_sim.cpp
+ *
+ *  Host simulator of the IRON temperature control to compare the KALMAN estimator (Src/stat.cpp), the PID input
+ *  of IRON::power() when IRON_KALMAN is defined, with the exponential average of 8 readings used without it. The T12 tip is simulated
+ *  by the first order plant, the readings have 4 units rms noise. The plants in the table match the KALMAN model
+ *  and differ from it in the gain or in the heat loss. The PID is the firmware one (Src/pid.cpp) with the default
+ *  IRON parameters. The simulator reports:
+ *  - open loop: the estimation noise at the constant power and the delay of the estimate during the full power pulse;
+ *  - closed loop at 1400 units: the deviation of the true temperature, the droop under 3 seconds load,
+ *    the overshoot after the load is removed and the overshoot after the preset temperature step of 100 units.
+ *  The exit status is 0 if the Kalman estimate is not worse in the closed loop checks for all the plants:
+ *  the droop, the recovery and the overshoot are not bigger, the deviation is not bigger by more than dev_margin
+ *  (the deviation is a fraction of the internal unit, the difference below the margin is the simulation noise).
+ *
+ *  g++ -O2 -Itools/host -IInc tools/kalman_sim.cpp tools/host/host.cpp Src/stat.cpp Src/pid.cpp Src/tools.cpp -o kalman_sim
+ *  ./kalman_sim [plant_gain plant_loss]						simulate the plant table or the specified plant
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include "stat.h"
+#include "pid.h"
+#include "tools.h"
+
+// The KALMAN model of T12 tip, the same as in IRON class (iron.h)
+static const uint32_t	model_loss		= 10066;			// The heat loss per TIM2 period, 6e-4 of the temperature, Q24
+static const uint32_t	model_gain		= 67109;			// The heating per TIM2 period, 4e-3 internal units per power unit, Q24
+static const uint32_t	model_q_temp	= 4096;				// The process noise of the temperature, Q16
+static const uint32_t	model_q_error	= 16;				// The process noise of the model error, Q16
+static const uint32_t	adc_noise		= 16 << 16;			// The variance of the readings, 4 units rms, Q16
+
+// The simulated tips: heating per power unit and heat loss of the temperature per TIM2 period
+static const double		plants[][2]		= { { 4e-3, 6e-4 }, { 6e-3, 9e-4 }, { 2.7e-3, 4e-4 }, { 8e-3, 6e-4 }, { 4e-3, 1.2e-3 } };
+static double			plant_gain		= 4e-3;
+static double			plant_loss		= 6e-4;
+static const double		noise_rms		= 4;
+static const uint16_t	max_power		= 1999;				// TIM2 period - 1
+static const uint16_t	cycle_ms		= 20;				// TIM2 period, ms
+static const double		dev_margin		= 0.05;				// The allowed excess of the closed loop deviation, rms
+
+static std::mt19937						rng(7);
+static std::normal_distribution<double>	gauss(0, 1);
+
+// The temperature of the tip (internal units above ambient). load - the extra heat loss coefficient
+struct PLANT {
+	double	temp	= 0;
+	void	step(uint16_t power, double load)			{ temp += plant_gain * power - (plant_loss + load) * temp; }
+	int32_t	read(void) {
+		long v = lround(temp + noise_rms * gauss(rng));
+		return (v < 0)?0:v;
+	}
+};
+
+// The PID input: the exponential average (the firmware) or the Kalman estimate
+struct FILTER {
+	bool		kalman;
+	EMP<8>		emp;
+	KALMAN		k;
+	FILTER(bool use_kalman) : kalman(use_kalman)		{ k.setup(model_loss, model_gain, model_q_temp, model_q_error, adc_noise); }
+	int32_t		update(int32_t z, uint16_t power)		{ return kalman?k.update(z, power):emp.average(z); }
+};
+
+struct RESULT {
+	double		noise;										// Open loop estimation error at constant power, rms
+	int32_t		delay;										// Open loop delay to reach +100 units during full power pulse, ms
+	double		deviation;									// Closed loop deviation of the true temperature, rms
+	double		droop;										// Closed loop maximum droop under load
+	double		recovery;									// Closed loop overshoot after the load is removed
+	double		overshoot;									// Closed loop overshoot after the preset temperature step
+};
+
+static void openLoop(bool kalman, RESULT *r) {
+	PLANT	plant;
+	FILTER	f(kalman);
+	double	err2 = 0, start = 0;
+	int32_t	n = 0, t_true = -1, t_est = -1;
+	for (int32_t i = 0; i < 3000; ++i) {
+		uint16_t p = (i >= 1000 && i < 1100)?max_power:200;	// Constant power, then 2 seconds of full power
+		int32_t est = f.update(plant.read(), p);
+		if (i >= 500 && i < 1000) {
+			err2 += (est - plant.temp) * (est - plant.temp);
+			++n;
+		}
+		if (i == 1000) start = plant.temp;
+		if (i > 1000 && i <= 1100) {
+			if (t_true < 0 && plant.temp >= start + 100) t_true = i;
+			if (t_est  < 0 && est >= start + 100) t_est = i;
+		}
+		plant.step(p, 0);
+	}
+	r->noise	= sqrt(err2 / n);
+	r->delay	= (t_est - t_true) * cycle_ms;
+}
+
+static void closedLoop(bool kalman, RESULT *r) {
+	PLANT	plant;
+	FILTER	f(kalman);
+	PID		pid;
+	pid.init(cycle_ms, 11, true);
+	pid.load(PIDparam(2300, 50, 735));						// The default IRON PID parameters, see config.cpp
+	pid.resetPID();
+	uint16_t	p = 0;
+	int16_t		preset = 1400;
+	double		dev2 = 0;
+	int32_t		n = 0;
+	r->droop = r->recovery = r->overshoot = 0;
+	for (int32_t i = 0; i < 12000; ++i) {
+		double load = (i >= 7000 && i < 7150)?4e-4:0;		// 3 seconds of soldering
+		if (i == 9000) preset += 100;
+		int32_t t = f.update(plant.read(), p);
+		p = constrain(pid.reqPower(preset, t), 0, max_power);
+		if (i >= 6000 && i < 7000) {
+			dev2 += (plant.temp - preset) * (plant.temp - preset);
+			++n;
+		}
+		if (i >= 7000 && i < 7500 && preset - plant.temp > r->droop)
+			r->droop = preset - plant.temp;
+		if (i >= 7150 && i < 9000 && plant.temp - preset > r->recovery)
+			r->recovery = plant.temp - preset;
+		if (i >= 9000 && plant.temp - preset > r->overshoot)
+			r->overshoot = plant.temp - preset;
+		plant.step(p, load);
+	}
+	r->deviation = sqrt(dev2 / n);
+}
+
+// Returns true if the Kalman estimate is not worse in the closed loop
+static bool simulate(void) {
+	RESULT res[2];
+	const char *name[2] = { "EMP<8>", "Kalman" };
+	printf("The plant: gain %g, loss %g\n", plant_gain, plant_loss);
+	for (uint8_t k = 0; k < 2; ++k) {
+		rng.seed(7);
+		openLoop(k, &res[k]);
+		rng.seed(7);
+		closedLoop(k, &res[k]);
+		printf("  %-7s open loop: noise %.2f rms, delay %d ms; closed loop: deviation %.2f rms, droop %.1f, recovery %.1f, overshoot %.1f\n",
+				name[k], res[k].noise, res[k].delay, res[k].deviation, res[k].droop, res[k].recovery, res[k].overshoot);
+	}
+	return (res[1].deviation <= res[0].deviation + dev_margin) && (res[1].droop <= res[0].droop) &&
+			(res[1].recovery <= res[0].recovery) && (res[1].overshoot <= res[0].overshoot);
+}
+
+int main(int argc, char *argv[]) {
+	bool better = true;
+	if (argc > 2) {
+		plant_gain = atof(argv[1]);
+		plant_loss = atof(argv[2]);
+		better = simulate();
+	} else {
+		for (uint8_t i = 0; i < sizeof(plants)/sizeof(plants[0]); ++i) {
+			plant_gain = plants[i][0];
+			plant_loss = plants[i][1];
+			better = simulate() && better;
+		}
+	}
+	printf("The Kalman estimate is %s the exponential average in the closed loop\n", better?"not worse than":"worse than");
+	return better?0:1;
+}
@@ -0,0 +1,109 @@
+/*
+ * polyfit_test.cpp
+ *
+ *  Host test of POLYFIT class (Src/stat.cpp) against the least squares fit in double precision.
+ *  The random calibration-like data sets (the real temperature in Celsius and the internal temperature reading,
+ *  3 to 8 points, the polynomial of degree up to 3 plus noise) are fitted by both implementations with the same
+ *  argument normalization and the polynomial degrees used by MCALIB::calibrationOLS(). The fixed point polynomial value should not
+ *  differ from the double one by more than max_error inside the fitted interval.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/polyfit_test.cpp tools/host/host.cpp Src/stat.cpp Src/tools.cpp -o polyfit_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stat.h"
+
+#define MCALIB_POINTS	(8)									// The maximum number of the calibration points, see mode.h
+
+static const double max_error = 0.75;						// The allowed difference: rounding to integer and the fixed point error
+
+// Solve the normal equations by Gauss elimination with partial pivoting. Returns false if the matrix is singular
+static bool fitDouble(const uint16_t x[], const uint16_t y[], uint8_t n, uint8_t degree, double xc, double xs, double c[]) {
+	const uint8_t size = degree + 1;
+	double a[POLY_MAX_DEGREE+1][POLY_MAX_DEGREE+2];
+	for (uint8_t i = 0; i < size; ++i) {
+		for (uint8_t j = 0; j <= size; ++j) a[i][j] = 0;
+		for (uint8_t k = 0; k < n; ++k) {
+			double t = (x[k] - xc) / xs;
+			for (uint8_t j = 0; j < size; ++j)
+				a[i][j] += pow(t, i + j);
+			a[i][size] += pow(t, i) * y[k];
+		}
+	}
+	for (uint8_t i = 0; i < size; ++i) {
+		uint8_t p = i;
+		for (uint8_t r = i+1; r < size; ++r)
+			if (fabs(a[r][i]) > fabs(a[p][i])) p = r;
+		if (fabs(a[p][i]) < 1e-9) return false;
+		for (uint8_t k = 0; k <= size; ++k) {
+			double s = a[i][k]; a[i][k] = a[p][k]; a[p][k] = s;
+		}
+		for (uint8_t r = i+1; r < size; ++r) {
+			double f = a[r][i] / a[i][i];
+			for (uint8_t k = i; k <= size; ++k)
+				a[r][k] -= f * a[i][k];
+		}
+	}
+	for (int8_t i = size-1; i >= 0; --i) {
+		double s = a[i][size];
+		for (uint8_t k = i+1; k < size; ++k)
+			s -= a[i][k] * c[k];
+		c[i] = s / a[i][i];
+	}
+	return true;
+}
+
+int main(void) {
+	uint32_t	fits	= 0, failed = 0, bad = 0;
+	double		worst	= 0;
+	srand(1);
+	for (uint16_t trial = 0; trial < 20000; ++trial) {
+		uint8_t n = 3 + rand() % (MCALIB_POINTS - 2);
+		uint16_t x[POLY_MAX_POINTS], y[POLY_MAX_POINTS];
+		double a0 = 300 + rand() % 600;
+		double a1 = 1 + (rand() % 150) / 100.0;
+		double a2 = (rand() % 200 - 100) / 1e4;
+		double a3 = (rand() % 200 - 100) / 1e6;
+		for (uint8_t i = 0; i < n; ++i) {
+			x[i] = 150 + i * 300 / n + rand() % (200 / n);	// The calibration points are spread over the temperature range
+			double X = x[i] - 300.0;
+			double Y = a0 + a1 * X + a2 * X * X + a3 * X * X * X + (rand() % 21 - 10);
+			y[i] = (Y < 0)?0:(Y > 4095)?4095:(uint16_t)Y;
+		}
+		uint8_t top = (n >= 6)?3:(n == 5)?2:1;
+		for (uint8_t degree = 1; degree <= top; ++degree) {
+			POLYFIT p;
+			int32_t x_min = x[0], x_max = x[0];
+			for (uint8_t i = 1; i < n; ++i) {
+				if (x[i] < x_min) x_min = x[i];
+				if (x[i] > x_max) x_max = x[i];
+			}
+			double xc = (x_min + x_max) >> 1;				// The same normalization as POLYFIT::fit()
+			double xs = (x_max - x_min + 1) >> 1;
+			if (xs < 1) xs = 1;
+			double c[POLY_MAX_DEGREE+1] = { 0 };
+			bool ok_double	= fitDouble(x, y, n, degree, xc, xs, c);
+			bool ok_fixed	= p.fit(x, y, n, degree);
+			if (!ok_fixed || !ok_double) {					// The points are too close to fit the polynomial
+				if (ok_fixed != ok_double) ++failed;
+				continue;
+			}
+			++fits;
+			for (int32_t X = x_min; X <= x_max; ++X) {
+				double t = (X - xc) / xs;
+				double v = c[0] + c[1]*t + c[2]*t*t + c[3]*t*t*t;
+				double e = fabs(v - p.value(X));
+				if (e > worst) worst = e;
+				if (e > max_error) {
+					if (bad < 5)
+						printf("points %d degree %d x %d: double %.2f fixed %d\n", n, degree, X, v, p.value(X));
+					++bad;
+				}
+			}
+		}
+	}
+	printf("POLYFIT: %u fits, worst error %.3f, errors above %.2f: %u, singular mismatches %u\n", fits, worst, max_error, bad, failed);
+	return (bad || failed)?1:0;
+}
@@ -0,0 +1,120 @@
+/*
+ * switch_test.cpp
+ *
+ *  Host check of SWITCH class (Src/stat.cpp).
+ *  Without the confirmation the status should be the same as the status of the previous implementation
+ *  (the average of the readings only) over 1M random readings: the random walk around the thresholds and the random jumps.
+ *  With the confirmation the status should change on the confirm-th raw reading beyond the threshold in a row
+ *  and should not change on the shorter spikes.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/switch_test.cpp tools/host/host.cpp Src/stat.cpp Src/tools.cpp -o switch_test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "stat.h"
+#include "tools.h"
+
+// The previous SWITCH implementation: the status follows the average of the readings
+class OLD_SWITCH : public EMP_AVERAGE {
+	public:
+		OLD_SWITCH(uint8_t len) : EMP_AVERAGE(len)			{ }
+		void		init(uint8_t h_len, uint16_t off, uint16_t on) {
+			EMP_AVERAGE::length(h_len);
+			if (on < off) on = off;
+			on_val	= on;
+			off_val	= off;
+			mode	= false;
+		}
+		bool		status(void)							{ return mode; }
+		void		update(uint16_t value) {
+			uint16_t max_val = on_val  + (on_val  >> 1);
+			uint16_t min_val = off_val - (off_val >> 1);
+			value = constrain(value, min_val, max_val);
+			uint16_t avg = EMP_AVERAGE::average(value);
+			if (mode) {
+				if (avg < off_val) mode = false;
+			} else {
+				if (avg > on_val) mode = true;
+			}
+		}
+	private:
+		bool		mode	= false;
+		int16_t		on_val	= 400;
+		int16_t		off_val	= 500;
+};
+
+static uint32_t	errors	= 0;
+
+static void check(bool ok, const char *what) {
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++errors;
+	}
+}
+
+// The IRON current switch (iron.cpp) and the tilt switch (unit.cpp) parameters
+static void compare(uint8_t len, uint16_t off, uint16_t on) {
+	SWITCH		sw;
+	OLD_SWITCH	old(len);
+	sw.init(len, off, on);
+	old.init(len, off, on);
+	int32_t		value		= off;
+	uint32_t	mismatch	= 0, changes = 0;
+	bool		prev		= false;
+	for (uint32_t i = 0; i < 1000000; ++i) {
+		if (rand() % 50 == 0) {
+			value = rand() % (2 * on + 1);							// The jump: the unit is connected or disconnected
+		} else {
+			value += rand() % 41 - 20;								// The noise around the current value
+			value = constrain(value, 0, 2 * on);
+		}
+		sw.update(value);
+		old.update(value);
+		if (sw.status() != old.status()) ++mismatch;
+		if (sw.status() != prev) ++changes;
+		prev = sw.status();
+	}
+	printf("SWITCH(%d, %d, %d) without confirmation: 1000000 readings, %u status changes, %u mismatches\n",
+			len, off, on, changes, mismatch);
+	check(mismatch == 0, "the same status as the previous implementation");
+}
+
+static void confirmation(void) {
+	const uint16_t	off = 500, on = 1000;						// The IRON current switch, see iron.h
+	const uint8_t	confirm = 2;
+	SWITCH sw;
+	sw.init(3, off, on, confirm);
+	for (uint8_t i = 0; i < 20; ++i) sw.update(0);
+	check(!sw.status(), "the switch is off");
+	sw.changed();
+
+	sw.update(1500);											// The single spike does not change the status
+	check(!sw.status(), "the spike does not switch on");
+	sw.update(0);
+	sw.update(0);
+	check(!sw.status() && !sw.changed(), "the status is kept after the spike");
+
+	sw.update(1500);
+	sw.update(1500);
+	check(sw.status() && sw.changed(), "switched on by two readings");
+
+	sw.update(0);
+	check(sw.status(), "the single low reading does not switch off");
+	sw.update(0);
+	check(!sw.status() && sw.changed(), "switched off by two readings");
+}
+
+int main(void) {
+	srand(1);
+	compare(3, 500, 1000);										// The IRON current
+	compare(2, 14, 20);											// The tilt switch
+	compare(8, 500, 500);
+	confirmation();
+	if (errors) {
+		printf("%u errors\n", errors);
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,303 @@
+#!/usr/bin/env python3
+"""
+Decoder of the controller telemetry stream (see Inc/telemetry.h).
+
+The stream is a sequence of COBS encoded frames terminated by zero byte.
+Each frame holds the data followed by CRC16-CCITT (little endian). The first data byte is the frame type:
+TLM_VERSION for the control cycle record (TLM_RECORD) or TLM_FLIGHT for the flight recorder entry
+(index, number of entries, FLREC_ENTRY, see Inc/recorder.h) dumped from the flight recorder mode.
+
+Usage:
+  telemetry.py decode --tcp localhost:9090 > log.csv   read the stream from OpenOCD RTT server
+  telemetry.py decode --file stream.bin > log.csv      read the stream from the file or the serial device
+  telemetry.py decode --tcp localhost:9090 --flight flight.csv   save the flight recorder dump also
+  telemetry.py simulate --pty                          write the synthetic stream to a new pseudo terminal
+  telemetry.py simulate --file stream.bin              write the synthetic stream to the file
+  telemetry.py selftest                                check the encoder and the decoder
+  telemetry.py selftest --host ./tlm_host              also decode the stream of the firmware encoder built for the host
+"""
+
+import argparse
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+TLM_VERSION = 1
+TLM_FLIGHT = 0x10
+RECORD = struct.Struct('<BBHIHHHHiiiHHHHH')
+FLIGHT = struct.Struct('<BBBHHHHHBB')
+FLIGHT_FIELDS = ('type', 'index', 'count', 'iron_temp', 'iron_pwm', 'gun_temp', 'gun_pwm', 'fan_pwm', 'mode', 'flags')
+FLIGHT_FLAGS = ((1, 'iron'), (2, 'gun'), (4, 'iron_hot'), (8, 'gun_hot'))
+FIELDS = ('version', 'mode', 'seq', 'time', 'iron_raw', 'iron_temp', 'iron_set', 'iron_pwm',
+          'pid_p', 'pid_i', 'pid_d', 'gun_temp', 'gun_set', 'gun_pwm', 'fan_pwm', 'ambient')
+IRON_MODES = ('OFF', 'ON', 'FIXED', 'COOLING', 'PID_TUNE')
+GUN_MODES = ('OFF', 'HEATING', 'ON', 'FIXED', 'COOLING', 'PID_TUNE')
+
+
+def crc16(data):
+    crc = 0xffff
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xffff
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xff:
+                out[code_pos] = code
+                code_pos, code = len(out), 1
+                out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            raise ValueError('bad COBS code')
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xff and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(rec):
+    raw = RECORD.pack(*(rec[f] for f in FIELDS))
+    raw += struct.pack('<H', crc16(raw))
+    return cobs_encode(raw) + b'\0'
+
+
+class Decoder:
+    """Split the byte stream into frames and check them. Counts bad frames and lost records."""
+
+    def __init__(self):
+        self.buff = bytearray()
+        self.bad = 0
+        self.lost = 0
+        self.last_seq = None
+
+    def feed(self, data):
+        self.buff += data
+        while True:
+            end = self.buff.find(b'\0')
+            if end < 0:
+                return
+            frame, self.buff = bytes(self.buff[:end]), self.buff[end + 1:]
+            rec = self.parse(frame)
+            if rec is not None:
+                yield rec
+
+    def parse(self, frame):
+        try:
+            raw = cobs_decode(frame)
+        except ValueError:
+            self.bad += 1
+            return None
+        if len(raw) < 3 or crc16(raw[:-2]) != struct.unpack('<H', raw[-2:])[0]:
+            self.bad += 1
+            return None
+        data = raw[:-2]
+        if data[0] == TLM_FLIGHT and len(data) == FLIGHT.size:
+            return dict(zip(FLIGHT_FIELDS, FLIGHT.unpack(data)))
+        if data[0] != TLM_VERSION or len(data) != RECORD.size:
+            self.bad += 1
+            return None
+        rec = dict(zip(FIELDS, RECORD.unpack(data)))
+        if self.last_seq is not None:
+            self.lost += (rec['seq'] - self.last_seq - 1) & 0xffff
+        self.last_seq = rec['seq']
+        return rec
+
+
+def csv_header():
+    return ','.join(FIELDS[2:] + ('iron_mode', 'gun_mode'))
+
+
+def mode_names(mode):
+    im, gm = mode & 0xf, mode >> 4
+    iron = IRON_MODES[im] if im < len(IRON_MODES) else str(im)
+    gun = GUN_MODES[gm] if gm < len(GUN_MODES) else str(gm)
+    return [iron, gun]
+
+
+def csv_line(rec):
+    return ','.join([str(rec[f]) for f in FIELDS[2:]] + mode_names(rec['mode']))
+
+
+def flight_header():
+    return ','.join(FLIGHT_FIELDS[1:-2] + ('iron_mode', 'gun_mode', 'flags'))
+
+
+def flight_line(rec):
+    flags = '|'.join(name for bit, name in FLIGHT_FLAGS if rec['flags'] & bit)
+    return ','.join([str(rec[f]) for f in FLIGHT_FIELDS[1:-2]] + mode_names(rec['mode']) + [flags])
+
+
+def open_source(args):
+    if args.tcp:
+        host, port = args.tcp.rsplit(':', 1)
+        sock = socket.create_connection((host, int(port)))
+        return lambda: sock.recv(4096)
+    fd = os.open(args.file, os.O_RDONLY)
+
+    def read():
+        try:
+            return os.read(fd, 4096)
+        except OSError:                                     # The pseudo terminal has been closed by the writer
+            return b''
+    return read
+
+
+def decode(args):
+    read = open_source(args)
+    dec = Decoder()
+    flight = None
+    print(csv_header())
+    try:
+        while True:
+            data = read()
+            if not data:
+                break
+            for rec in dec.feed(data):
+                if rec.get('type') == TLM_FLIGHT:
+                    if rec['index'] == 0:                   # New dump started
+                        if flight:
+                            flight.close()
+                        flight = open(args.flight, 'w')
+                        print(flight_header(), file=flight)
+                        print('flight recorder dump: %d entries' % rec['count'], file=sys.stderr)
+                    if flight:
+                        print(flight_line(rec), file=flight, flush=True)
+                else:
+                    print(csv_line(rec), flush=True)
+    except KeyboardInterrupt:
+        pass
+    if flight:
+        flight.close()
+    print('bad frames: %d, lost records: %d' % (dec.bad, dec.lost), file=sys.stderr)
+
+
+def synthetic(n):
+    temp, t_set = 300, 1200
+    for i in range(n):
+        err = t_set - temp
+        pwr = max(0, min(1999, err * 4))
+        temp += (pwr - (temp - 300) * 2) // 100
+        yield dict(version=TLM_VERSION, mode=1, seq=i & 0xffff, time=i * 20, iron_raw=temp + 3,
+                   iron_temp=temp, iron_set=t_set, iron_pwm=pwr, pid_p=err * 10, pid_i=err, pid_d=0,
+                   gun_temp=0, gun_set=0, gun_pwm=0, fan_pwm=0, ambient=1600)
+
+
+def simulate(args):
+    if args.pty:
+        import pty
+        master, slave = pty.openpty()
+        import tty
+        tty.setraw(slave)
+        print('Reading device: %s' % os.ttyname(slave), file=sys.stderr)
+        write = lambda b: os.write(master, b)
+    else:
+        f = open(args.file, 'wb')
+        write = f.write
+    for rec in synthetic(args.count):
+        write(encode_frame(rec))
+        if args.pty:
+            time.sleep(0.02)
+    if not args.pty:
+        f.close()
+
+
+def selftest(args):
+    recs = list(synthetic(500))
+    stream = b''.join(encode_frame(r) for r in recs)
+    dec = Decoder()
+    out = []
+    for i in range(0, len(stream), 7):                      # Feed the stream by small chunks
+        out += list(dec.feed(stream[i:i + 7]))
+    assert [r['seq'] for r in out] == [r['seq'] for r in recs] and dec.bad == 0 and dec.lost == 0
+    frames = [encode_frame(r) for r in recs[:10]]
+    broken = bytearray(frames[3])
+    broken[5] ^= 0x55                                       # Corrupt one frame
+    frames[3] = bytes(broken)
+    del frames[6]                                           # Lose one frame
+    dec = Decoder()
+    out = list(dec.feed(b''.join(frames)))
+    assert len(out) == 8 and dec.bad == 1 and dec.lost == 2
+    entry = FLIGHT.pack(TLM_FLIGHT, 5, 128, 1000, 200, 0, 0, 0, 1, 5)
+    frame = cobs_encode(entry + struct.pack('<H', crc16(entry))) + b'\0'
+    out = list(Decoder().feed(frame))
+    assert len(out) == 1 and out[0]['index'] == 5 and flight_line(out[0]).endswith('iron|iron_hot')
+    if args.host:
+        host_selftest(args.host)
+    print('selftest passed')
+
+
+def host_record(n):
+    """The record number n written by tools/tlm_host.cpp"""
+    return dict(version=TLM_VERSION, mode=1 | (2 << 4), seq=n & 0xffff, time=n * 20,
+                iron_raw=0 if n % 7 == 0 else n, iron_temp=1000 + n, iron_set=1200, iron_pwm=(n * 37) % 2000,
+                pid_p=-n * 1000, pid_i=n << 16, pid_d=-(n & 0xff), gun_temp=0 if n & 0x100 else 500,
+                gun_set=0, gun_pwm=0xff, fan_pwm=0, ambient=0xff)
+
+
+def host_selftest(path):
+    """Decode the stream of the firmware encoder (Src/telemetry.cpp) built for the host, see tools/tlm_host.cpp"""
+    run = subprocess.run([path], stdout=subprocess.PIPE, stderr=subprocess.PIPE, check=True)
+    summary = run.stderr.decode().split()
+    records, dropped = int(summary[1]), int(summary[3])
+    dec = Decoder()
+    recs, flight = [], []
+    for rec in dec.feed(run.stdout):
+        (flight if rec.get('type') == TLM_FLIGHT else recs).append(rec)
+    assert dec.bad == 0, 'bad frames in the firmware stream'
+    assert dropped > 0 and dec.lost == dropped and len(recs) + dropped == records, 'lost records mismatch'
+    for rec in recs:
+        assert rec == host_record(rec['seq']), 'record %d mismatch' % rec['seq']
+    assert [r['index'] for r in flight] == [0, 1, 2] and flight[2]['iron_temp'] == 1002
+    assert flight_line(flight[2]).endswith('iron|iron_hot')
+    print('firmware stream: %d records, %d dropped, %d flight entries' % (len(recs), dropped, len(flight)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Controller telemetry stream tool')
+    sub = parser.add_subparsers(dest='cmd', required=True)
+    p = sub.add_parser('decode', help='decode the stream to CSV')
+    src = p.add_mutually_exclusive_group(required=True)
+    src.add_argument('--tcp', help='host:port of the RTT server')
+    src.add_argument('--file', help='file or serial device')
+    p.add_argument('--flight', default='flight.csv', help='file to save the flight recorder dump')
+    p.set_defaults(func=decode)
+    p = sub.add_parser('simulate', help='write the synthetic stream')
+    dst = p.add_mutually_exclusive_group(required=True)
+    dst.add_argument('--pty', action='store_true', help='create pseudo terminal')
+    dst.add_argument('--file', help='output file')
+    p.add_argument('--count', type=int, default=3000, help='number of records')
+    p.set_defaults(func=simulate)
+    p = sub.add_parser('selftest', help='check the encoder and the decoder')
+    p.add_argument('--host', help='the firmware encoder built for the host, see tools/tlm_host.cpp')
+    p.set_defaults(func=selftest)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,92 @@
+/*
+ * tlm_host.cpp
+ *
+ *  Host build of the firmware telemetry encoder (Src/telemetry.cpp) to check tools/telemetry.py decoder
+ *  against the real CRC16 and COBS implementation. The program writes the RTT ring buffer content to stdout:
+ *  the control cycle records with the values derived from the record number (see record()), some of them
+ *  dropped because the ring buffer is not read for a while, then a few flight recorder entries.
+ *  The summary line "records <n> dropped <n>" is printed to stderr.
+ *
+ *  g++ -O2 -Itools/host -IInc tools/tlm_host.cpp -o tlm_host
+ *  tools/telemetry.py selftest --host ./tlm_host
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../Src/telemetry.cpp"								// Include the source to read the static ring buffer
+#include "recorder.h"
+
+#define RECORDS		(600)
+
+// Write the unread part of the ring buffer to stdout, as the RTT host does
+static void drain(void) {
+	RTT_BUFFER *b = &rtt_cb.up[0];
+	uint32_t rd = b->rd_off;
+	while (rd != b->wr_off) {
+		putchar(b->buffer[rd]);
+		rd = (rd + 1) & (TLM_BUFF_SIZE-1);
+	}
+	b->rd_off = rd;
+}
+
+// The record fields are the functions of the record number n, telemetry.py selftest checks them the same way
+static void record(TLM_RECORD *r, uint32_t n) {
+	memset(r, 0, sizeof(TLM_RECORD));
+	r->mode			= 1 | (2 << 4);
+	r->time			= n * 20;
+	r->iron_raw		= (n % 7 == 0)?0:n;						// Zero bytes check COBS encoder
+	r->iron_temp	= 1000 + n;
+	r->iron_set		= 1200;
+	r->iron_pwm		= (n * 37) % 2000;
+	r->pid_p		= -(int32_t)n * 1000;
+	r->pid_i		= n << 16;
+	r->pid_d		= -(int32_t)(n & 0xff);
+	r->gun_temp		= (n & 0x100)?0:500;
+	r->gun_pwm		= 0xff;
+	r->ambient		= 0x00ff;
+}
+
+static void fail(const char *msg) {
+	fprintf(stderr, "tlm_host: %s\n", msg);
+	exit(1);
+}
+
+int main(void) {
+	uint32_t dropped = 0;
+	for (uint32_t n = 0; n < RECORDS; ++n) {
+		TLM_RECORD r;
+		record(&r, n);
+		if (!tlmSend(&r)) ++dropped;
+		if ((n < 200 || n > 300) && n % 20 == 19)			// The host does not read the stream for a while
+			drain();
+	}
+	drain();
+	if (dropped == 0 || tlmDropped() != dropped)
+		fail("the dropped records are not counted");
+
+	// The flight recorder dump: the rejected frames are not lost records
+	FLREC_ENTRY e;
+	memset(&e, 0, sizeof(e));
+	uint8_t data[sizeof(FLREC_ENTRY) + 2];
+	memset(data, 0, sizeof(data));
+	while (tlmSendData(TLM_FLIGHT, data, sizeof(data)))		// Fill up the ring buffer
+		;
+	if (tlmRejected() != 1 || tlmDropped() != dropped)
+		fail("the rejected data frames are counted as the dropped records");
+	RTT_BUFFER *b	= &rtt_cb.up[0];
+	b->rd_off		= b->wr_off;							// Discard the filler
+	for (uint8_t i = 0; i < 3; ++i) {
+		e.iron_temp	= 1000 + i;
+		e.iron_pwm	= i * 10;
+		e.mode		= 1;
+		e.flags		= (i == 2)?5:1;
+		data[0]		= i;
+		data[1]		= 3;
+		memcpy(&data[2], &e, sizeof(e));
+		if (!tlmSendData(TLM_FLIGHT, data, sizeof(data)))
+			fail("cannot send the flight recorder entry");
+	}
+	drain();
+	fprintf(stderr, "records %u dropped %u\n", RECORDS, dropped);
+	return 0;
+}